@@ -39,7 +39,9 @@ void setup() {
   Serial.begin(115200);
 
   settings = new YoYoSettings(512); //Settings must be created here in Setup() as contains call to EEPROM.begin() which will otherwise fail
-  wifiManager.init(settings, NULL, onYoYoMessageGET, onYoYoMessagePOST, true);
+  wifiManager.init(settings, NULL, NULL, NULL, true);
+  wifiManager.on("/yoyo/colour", HTTP_GET, getColour);
+  wifiManager.on("/yoyo/colour", HTTP_POST, setColour);
   wifiManager.begin("YoYoMachines", "blinkblink", false);
   
   pinMode(LED_RED_PIN, OUTPUT);
@@ -57,34 +59,23 @@ void loop() {
   button.check();
 }
 
-bool onYoYoMessageGET(JsonVariant message) {
-  bool success = false;
+bool getColour(int route, JsonVariant message) {
+  message["payload"]["red"] = red;
+  message["payload"]["green"] = green;
+  message["payload"]["blue"] = blue;
 
-  if(message["path"] == "/yoyo/colour") {
-    message["payload"]["red"] = red;
-    message["payload"]["green"] = green;
-    message["payload"]["blue"] = blue;
-
-    success = true;
-  }
-
-  return(success);
+  return(true);
 }
 
-bool onYoYoMessagePOST(JsonVariant message) {
-  bool success = false;
-  
-  if(message["path"] == "/yoyo/colour") {
-    red = message["payload"]["red"].as<int>();
-    green = message["payload"]["green"].as<int>();
-    blue = message["payload"]["blue"].as<int>();
-    updateLEDColourRGB();
-
-    message["broadcast"] = true;
-    success = true;
-  }
+bool setColour(int route, JsonVariant message) {
+  red = message["payload"]["red"].as<int>();
+  green = message["payload"]["green"].as<int>();
+  blue = message["payload"]["blue"].as<int>();
+  updateLEDColourRGB();
+
+  message["broadcast"] = true;
 
-  return(success);
+  return(true);
 }
 
 void updateLEDColourRGB() {
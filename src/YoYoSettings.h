@@ -5,6 +5,8 @@
 #include <EEPROM.h>
 #include <StreamUtils.h>
 
+#include "YoYoWiFiManager/YoYoLog.h"
+
 #if defined(ESP8266)
     #define YY_MAX_EEPROM_CAPACITY_BYTES  512
 #elif defined(ESP32)
@@ -27,7 +29,6 @@ class YoYoSettings : public DynamicJsonDocument, public YoYoNetworkSettingsInter
 
     public:
         YoYoSettings(int capacityBytes, int address = 0) : DynamicJsonDocument(capacityBytes) {
-            Serial.println("Settings");
             init(capacityBytes, address);
         }
 
@@ -40,7 +41,7 @@ class YoYoSettings : public DynamicJsonDocument, public YoYoNetworkSettingsInter
         bool addNetwork(const char *ssid, const char *password, bool force = false, bool autosave = true) {
             bool success = false;
             
-            Serial.printf("Settings::addNetwork %s  %s\n", ssid, password);
+            YY_LOGD("Settings::addNetwork %s", ssid);
 
             int index = getNetwork(ssid);
             if(index >= 0) {
@@ -56,6 +57,7 @@ class YoYoSettings : public DynamicJsonDocument, public YoYoNetworkSettingsInter
                 }
             }
 
+            if(success) changed();
             if(autosave && success) save();
 
             return(success);
@@ -82,6 +84,7 @@ class YoYoSettings : public DynamicJsonDocument, public YoYoNetworkSettingsInter
             if(index >= 0 && index < credentials.size()) {
                 credentials.remove(index);
                 garbageCollect();
+                changed();
 
                 success = true;
             }
@@ -102,6 +105,7 @@ class YoYoSettings : public DynamicJsonDocument, public YoYoNetworkSettingsInter
         void clearNetworks(bool autosave = true) {
             (*this)["credentials"].clear();
             garbageCollect();
+            changed();
 
             if(autosave) save();
         }
@@ -165,6 +169,7 @@ class YoYoSettings : public DynamicJsonDocument, public YoYoNetworkSettingsInter
                         }
                     }
                 }
+                changed();
                 if(autosave) save();
             }
         }
@@ -185,9 +190,7 @@ class YoYoSettings : public DynamicJsonDocument, public YoYoNetworkSettingsInter
         bool save() {
             bool success = false;
 
-            Serial.println("SAVE---SAVE---SAVE---SAVE---SAVE");
-            serializeJson(*this, Serial);
-            Serial.println();
+            YY_LOGD("Settings::save");
 
             EepromStream eepromStream(this -> eepromAddress, this -> eepromCapacityBytes);
             serializeJson(*this, eepromStream);
@@ -1,9 +1,58 @@
 #include "YoYoWiFiManager.h"
 
-YoYoWiFiManager::YoYoWiFiManager() {
-}
-
-void YoYoWiFiManager::init(YoYoNetworkSettingsInterface *settings, voidCallbackPtr onYY_CONNECTEDhandler, jsonCallbackPtr getHandler, jsonCallbackPtr postHandler, bool startWebServerOnceConnected, int webServerPort, int wifiLEDPin, bool wifiLEDOn) {
+YoYoWiFiManagerBase::YoYoWiFiManagerBase(const yy_config_t &config) : config(config), fileSystemGeneration(0) {
+  //added in the order of yy_timer_t:
+  scheduler.add("wifi_multi",     onWiFiMultiDue,   this, MIN_MULTIUPDATEINTERVAL);
+  scheduler.add("client_list",    onClientListDue,  this, MIN_CLIENTLISTUPDATEINTERVAL);
+  scheduler.add("http_clients",   onHTTPClientsDue, this, HTTP_CLIENT_EVICT_INTERVAL);
+  scheduler.add("wifi_led",       onWifiLEDDue,     this, WIFI_LED_INTERVAL);
+  scheduler.add("client_timeout", onClientTimeOut,  this);
+  scheduler.add("server_timeout", onServerTimeOut,  this);
+  scheduler.add("peer_election",  onPeerElectionDue, this);
+}
+
+//Hands the components their storage - sized by config:
+void YoYoWiFiManagerBase::setStorage(yy_broadcast_t *broadcasts, yy_peer_delivery_t *deliveries, YoYoJsonArena *arenas, uint8_t *arenaMemory, YoYoResponseCache::entry_t *cacheEntries, uint8_t *uploadBuffer, YoYoAssetSync::file_t *assetFiles, YoYoHistogram *routeHistograms, YoYoAdmission::entry_t *requests, YoYoIntentQueue::cell_t *intentCells, YoYoHTTPClientPool::Connection *httpConnections, char *logBuffer, YoYoRoutes::route_t *routeTable, uint8_t *routeOrder) {
+  broadcastQueue.setStorage(broadcasts, config.broadcastQueueDepth, deliveries, config.maxPeers);
+  jsonArenas.setStorage(arenas, config.requestArenas, arenaMemory, config.requestArenaBytes);
+  responseCache.setStorage(cacheEntries, config.responseCacheSize);
+  metrics.setStorage(routeHistograms, config.metricsRoutes);
+
+  admission.setStorage(requests, config.maxStaticRequests + config.maxApiRequests + config.maxCaptiveRequests + config.maxTransferRequests);
+  admission.setLimit(YY_REQUEST_STATIC, config.maxStaticRequests);
+  admission.setLimit(YY_REQUEST_API, config.maxApiRequests);
+  admission.setLimit(YY_REQUEST_CAPTIVE, config.maxCaptiveRequests);
+  admission.setLimit(YY_REQUEST_TRANSFER, config.maxTransferRequests);
+  intents.setStorage(intentCells, config.intentQueueDepth);
+  httpClientPool.setStorage(httpConnections, config.httpClients);
+  yyLog().setStorage(logBuffer, config.logBufferBytes);
+  routes.setStorage(routeTable, routeOrder, config.maxRoutes);
+
+  //built-in endpoints - added in the order of yy_route_t:
+  routes.add("/yoyo/networks",    HTTP_GET);
+  routes.add("/yoyo/clients",     HTTP_GET);
+  routes.add("/yoyo/peers",       HTTP_GET);
+  routes.add("/yoyo/credentials", HTTP_GET | HTTP_POST);
+  routes.add("/yoyo/broadcast",   HTTP_POST);
+  routes.add("/yoyo/batch",       HTTP_POST);
+  routes.add("/yoyo/upload",      HTTP_POST);
+  routes.add(YY_FIRMWARE_URI,        HTTP_GET | HTTP_POST);
+  routes.add(YY_MANIFEST_URI,        HTTP_GET);
+  routes.add(YY_ASSET_URI,           HTTP_GET);
+  routes.add(YY_METRICS_URI,         HTTP_GET);
+  routes.add(YY_LOGS_URI,            HTTP_GET);
+
+  if(config.fileTransfer) {
+    fileUpload.setStorage(uploadBuffer, config.uploadBufferBytes);
+    assetSync.setStorage(assetFiles, config.assetSyncMaxFiles);
+  }
+}
+
+int YoYoWiFiManagerBase::on(const char *path, WebRequestMethodComposite methods, routeCallbackPtr handler) {
+  return(routes.add(path, methods, handler));
+}
+
+void YoYoWiFiManagerBase::init(YoYoNetworkSettingsInterface *settings, voidCallbackPtr onYY_CONNECTEDhandler, jsonCallbackPtr getHandler, jsonCallbackPtr postHandler, bool startWebServerOnceConnected, int webServerPort, int wifiLEDPin, bool wifiLEDOn) {
   this -> settings = settings;
   this -> onYY_CONNECTEDhandler = onYY_CONNECTEDhandler;
   this -> yoYoCommandGetHandler = getHandler;
@@ -29,16 +78,26 @@ void YoYoWiFiManager::init(YoYoNetworkSettingsInterface *settings, voidCallbackP
   peerNetworkPassword[0] = NULL;
 
   randomSeed(getChipId());
+
+  //broadcast sequence numbers and file ETags must not restart from the same value after a reboot:
+  #if defined(ESP8266)
+    broadcastSeq = RANDOM_REG32;
+    fileSystemGeneration = RANDOM_REG32;
+  #elif defined(ESP32)
+    broadcastSeq = esp_random();
+    fileSystemGeneration = esp_random();
+  #endif
 }
 
-boolean YoYoWiFiManager::begin(char const *apName, char const *apPassword, bool autoconnect) {
+boolean YoYoWiFiManagerBase::begin(char const *apName, char const *apPassword, bool autoconnect) {
   running = true;
+  connectingSinceMs = millis();
 
   addPeerNetwork((char *)apName, (char *)apPassword);
   wifiMulti.run();  //prioritise joining peer networks over known networks
 
   if(autoconnect && settings && settings -> hasNetworkCredentials()) {
-    Serial.println("network credentials available");
+    YY_LOGI("network credentials available");
     addKnownNetworks();
     setMode(YY_MODE_CLIENT, true);
   }
@@ -46,14 +105,26 @@ boolean YoYoWiFiManager::begin(char const *apName, char const *apPassword, bool
     setMode(YY_MODE_PEER_CLIENT, true); //attempt to join peer network;
   }
 
+  scan.request();   //so there are results to match SSIDs against
+  if(peerElection) setPeerElection(true);
+
   return(true);
 }
 
-void YoYoWiFiManager::end() {
+void YoYoWiFiManagerBase::end() {
+  #if defined(ESP32)
+    if(isOtherTask()) {
+      StaticJsonDocument<JSON_OBJECT_SIZE(1)> message;
+      message.to<JsonObject>();
+      if(!pushIntent(YY_INTENT_END, message.as<JsonVariant>(), IPAddress())) YY_LOGW("intent queue full - not ended");
+      return;
+    }
+  #endif
+
   running = false;
 }
 
-uint32_t YoYoWiFiManager::getChipId() {
+uint32_t YoYoWiFiManagerBase::getChipId() {
   uint32_t chipId = 0;
 
   #if defined(ESP8266)
@@ -67,45 +138,69 @@ uint32_t YoYoWiFiManager::getChipId() {
   return(chipId);
 }
 
-void YoYoWiFiManager::connect(char const *ssid, char const *password) {
+void YoYoWiFiManagerBase::connect(char const *ssid, char const *password) {
+  #if defined(ESP32)
+    if(isOtherTask()) {
+      StaticJsonDocument<JSON_OBJECT_SIZE(2)> message;
+      message["ssid"] = ssid;
+      message["password"] = password;
+      if(!pushIntent(YY_INTENT_CONNECT, message.as<JsonVariant>(), IPAddress())) YY_LOGW("intent queue full - not connected");
+      return;
+    }
+  #endif
+
   addNetwork(ssid, password, false);
   connect();
 }
 
-void YoYoWiFiManager::connect() {
+void YoYoWiFiManagerBase::connect() {
+  #if defined(ESP32)
+    if(isOtherTask()) {
+      StaticJsonDocument<JSON_OBJECT_SIZE(1)> message;
+      message.to<JsonObject>();
+      if(!pushIntent(YY_INTENT_CONNECT, message.as<JsonVariant>(), IPAddress())) YY_LOGW("intent queue full - not connected");
+      return;
+    }
+  #endif
+
   running = true;
+  connectingSinceMs = millis();
   //Once in YY_MODE_CLIENT mode - loop() will trigger wifiMulti.run()
   setMode(YY_MODE_CLIENT);
 }
 
-void YoYoWiFiManager::startPeerNetworkAsAP() {
-  Serial.print("Wifi name:");
-  Serial.println(peerNetworkSSID);
+void YoYoWiFiManagerBase::startPeerNetworkAsAP() {
+  YY_LOGI("peer network: %s", peerNetworkSSID);
 
   WiFi.softAPConfig(apIP, apIP, IPAddress(255, 255, 255, 0));
-  WiFi.softAP(peerNetworkSSID, peerNetworkPassword);
-  IPAddress myIP = WiFi.softAPIP();
-  Serial.println(myIP);
+  //no more stations than a broadcast can reach:
+  int maxConnections = (config.maxPeers > 0 && config.maxPeers < YY_SOFTAP_MAX_CONNECTIONS) ? config.maxPeers : YY_SOFTAP_MAX_CONNECTIONS;
+  WiFi.softAP(peerNetworkSSID, peerNetworkPassword, 1, 0, maxConnections);
+  YY_LOGI("peer server: %s", WiFi.softAPIP().toString().c_str());
 
   //Resolve all hostnames to this IP address:
   dnsServer.start(DNS_PORT, "*", apIP);
 }
 
-void YoYoWiFiManager::stopPeerNetworkAsAP() {
+void YoYoWiFiManagerBase::stopPeerNetworkAsAP() {
   WiFi.softAPdisconnect(true);
   dnsServer.stop();
 }
 
-void YoYoWiFiManager::startWebServer() {
+void YoYoWiFiManagerBase::startWebServer() {
   if(webserver == NULL) {
-    Serial.println("startWebServer");
+    YY_LOGI("startWebServer");
     webserver = new AsyncWebServer(webServerPort);
     webserver -> addHandler(this);
+    //only requests that weren't admitted by canHandle() end up here:
+    webserver -> onNotFound([this](AsyncWebServerRequest *request) {
+      sendUnavailable(request, YY_ADMISSION_RETRY_AFTER_S);
+    });
     webserver -> begin();
   }
 }
 
-void YoYoWiFiManager::stopWebServer() {
+void YoYoWiFiManagerBase::stopWebServer() {
   //TODO: this is crashing on the ESP8266:
   if(webserver != NULL) {
     // Serial.println("stopWebServer");
@@ -115,7 +210,7 @@ void YoYoWiFiManager::stopWebServer() {
   }
 }
 
-void YoYoWiFiManager::addPeerNetwork(char *ssid, char *password) {
+void YoYoWiFiManagerBase::addPeerNetwork(char *ssid, char *password) {
   if(ssid) {
     strcpy(peerNetworkSSID, ssid);
     if(password != NULL) strcpy(peerNetworkPassword, password);
@@ -124,28 +219,27 @@ void YoYoWiFiManager::addPeerNetwork(char *ssid, char *password) {
   }
 }
 
-void YoYoWiFiManager::addKnownNetworks() {
+void YoYoWiFiManagerBase::addKnownNetworks() {
   if(settings) {
     int numberOfNetworkCredentials = settings->getNumberOfNetworkCredentials();
-    char *ssid = new char[SSID_MAX_LENGTH];
-    char *password = new char[PASSWORD_MAX_LENGTH];
+    char ssid[SSID_MAX_LENGTH];
+    char password[PASSWORD_MAX_LENGTH];
     for(int n = 0; n < numberOfNetworkCredentials; ++n) {
       settings -> getSSID(n, ssid);
       settings -> getPassword(n, password);
       addNetwork(ssid, password, false);
     }
-    delete ssid, password;
   }
 }
 
-bool YoYoWiFiManager::addNetwork(char const *ssid, char const *password, bool save) {
-  Serial.printf("YoYoWiFiManager::addNetwork %s  %s\n", ssid, password);
+bool YoYoWiFiManagerBase::addNetwork(char const *ssid, char const *password, bool save) {
+  YY_LOGD("addNetwork %s", ssid);
 
   bool success = false;
 
   if(ssid && password) {
     if(strlen(ssid) > 0 && strlen(ssid) < SSID_MAX_LENGTH) {
-      char *matchingSSID = new char[SSID_MAX_LENGTH];
+      char matchingSSID[SSID_MAX_LENGTH];
 
       if(findNetwork(ssid, matchingSSID, false, true, 2)) {
         ssid = matchingSSID;
@@ -153,46 +247,57 @@ bool YoYoWiFiManager::addNetwork(char const *ssid, char const *password, bool sa
 
       if(wifiMulti.addAP(ssid, password)) {
         if(save && settings) {
-          success = settings -> addNetwork(ssid, password, true);
+          //a network that's already known can always be updated:
+          bool full = config.maxCredentials > 0 && settings -> getNumberOfNetworkCredentials() >= config.maxCredentials && settings -> getNetwork(ssid) < 0;
+          if(!full) success = settings -> addNetwork(ssid, password, true);
+          settingsGeneration++;
         }
         else success = true;
       }
-      delete matchingSSID;
     }
   }
 
   return(success);
 }
 
-bool YoYoWiFiManager::findNetwork(char const *ssid, char *matchingSSID, bool autocomplete, bool autocorrect, int autocorrectError) {
+bool YoYoWiFiManagerBase::findNetwork(char const *ssid, char *matchingSSID, bool autocomplete, bool autocorrect, int autocorrectError) {
   bool result = false;
 
-  int numberOfNetworks = scanNetworks();
-  for(int n = 0; n < numberOfNetworks && !result; ++n) {
-    bool match = WiFi.SSID(n).equals(ssid) || 
-                  (autocomplete && WiFi.SSID(n).startsWith(ssid)) || 
-                  (autocorrect && Levenshtein::levenshteinIgnoreCase(ssid, WiFi.SSID(n).c_str()) < autocorrectError);
+  scan.request();   //keeps the scan results up to date
+
+  yy_network_t network;
+  uint32_t generation = scan.getGeneration();
+  for(int n = 0; scan.get(n, &network, generation) && !result; ++n) {
+    bool match = strcmp(network.ssid, ssid) == 0 || 
+                  (autocomplete && strncmp(network.ssid, ssid, strlen(ssid)) == 0) || 
+                  (autocorrect && Levenshtein::levenshteinIgnoreCase(ssid, network.ssid) < autocorrectError);
 
     if(match) {
       result = true;
-      strcpy(matchingSSID, WiFi.SSID(n).c_str());
+      strcpy(matchingSSID, network.ssid);
     }
   }
 
   return(result);
 }
 
-yy_status_t YoYoWiFiManager::getStatus() {
+yy_status_t YoYoWiFiManagerBase::getStatus() {
   yy_status_t yyStatus = currentStatus;
 
-  uint8_t wlStatus = WiFi.status();
-  if(currentMode != YY_MODE_PEER_SERVER && millis() > (lastUpdatedMultiAtMs + MIN_MULTIUPDATEINTERVAL)) {
-    wlStatus = wifiMulti.run();
-    lastUpdatedMultiAtMs = millis();
-  }
+  #if defined(ESP32)
+    if(isOtherTask()) {
+      portENTER_CRITICAL(&snapshotMux);
+      yyStatus = snapshot.status;
+      portEXIT_CRITICAL(&snapshotMux);
+      return(yyStatus);
+    }
+  #endif
+
+  uint8_t wlStatus = WiFi.status();   //wifiMulti.run() is scheduled
 
   if(wlStatus == WL_CONNECTED) {
-    if(WiFi.SSID().equals(peerNetworkSSID)) {
+    char ssid[SSID_MAX_LENGTH];
+    if(strcmp(getConnectedSSID(ssid), peerNetworkSSID) == 0) {
       yyStatus = YY_CONNECTED_PEER_CLIENT;
     }
     else yyStatus = YY_CONNECTED;
@@ -207,33 +312,53 @@ yy_status_t YoYoWiFiManager::getStatus() {
   return(yyStatus);
 }
 
-uint8_t YoYoWiFiManager::loop() {
+uint8_t YoYoWiFiManagerBase::loop() {
+  #if defined(ESP32)
+    if(isOtherTask()) return(getStatus());   //the manager's task does the work
+  #endif
+
+  uint32_t startedAtUs = micros();
   yy_status_t yyStatus = (yy_status_t) WiFi.status();
 
   if(running) {
+    processIntents();
     updateMode();
     yyStatus = getStatus();
     
     //Only when the status changes:
     if(currentStatus != yyStatus) {
-      char *currentStatusString = new char[32];
-      char *yyStatusString = new char[32];
+      char currentStatusString[32];
+      char yyStatusString[32];
       getStatusAsString(currentStatus, currentStatusString);
       getStatusAsString(yyStatus, yyStatusString);
-      Serial.printf("STATUS:  %s\t>\t%s\n", currentStatusString, yyStatusString);
-      delete currentStatusString, yyStatusString;
+      YY_LOGI("STATUS:  %s\t>\t%s", currentStatusString, yyStatusString);
+      char ssid[SSID_MAX_LENGTH];
+      getConnectedSSID(ssid);
+
+      bool wasConnected = (currentStatus == YY_CONNECTED || currentStatus == YY_CONNECTED_PEER_CLIENT);
+      bool isConnected = (yyStatus == YY_CONNECTED || yyStatus == YY_CONNECTED_PEER_CLIENT);
+      if(isConnected && !wasConnected) {
+        metrics.connects++;
+        metrics.timeToConnected.add((millis() - connectingSinceMs) * 1000);
+      }
+      else if(wasConnected && !isConnected) {
+        metrics.disconnects++;
+        connectingSinceMs = millis();
+      }
 
       switch(yyStatus) {
         case YY_CONNECTED:
           //implicitly in YY_MODE_CLIENT
-          if(WiFi.SSID().equals(peerNetworkSSID)) {
+          if(strcmp(ssid, peerNetworkSSID) == 0) {
             setMode(YY_MODE_PEER_CLIENT, true);
           }
           else {
-            Serial.printf("Connected to: %s\n", WiFi.SSID().c_str());
-            Serial.println(WiFi.localIP());
+            YY_LOGI("Connected to: %s %s", ssid, WiFi.localIP().toString().c_str());
 
-            if(settings) settings -> setLastNetwork(WiFi.SSID().c_str());
+            if(settings) {
+              settings -> setLastNetwork(ssid);
+              settingsGeneration++;
+            }
           }
           if(onYY_CONNECTEDhandler) {
             onYY_CONNECTEDhandler();
@@ -241,8 +366,7 @@ uint8_t YoYoWiFiManager::loop() {
         break;
         //implicitly in YY_MODE_PEER_CLIENT
         case YY_CONNECTED_PEER_CLIENT:
-          Serial.printf("Connected to Peer Network: %s\n", WiFi.SSID().c_str());
-          Serial.println(WiFi.localIP());
+          YY_LOGI("Connected to Peer Network: %s %s", ssid, WiFi.localIP().toString().c_str());
           setMode(YY_MODE_PEER_CLIENT, true);
         break;
         //implicitly in YY_MODE_PEER_SERVER
@@ -263,6 +387,8 @@ uint8_t YoYoWiFiManager::loop() {
       case YY_MODE_CLIENT:
         break;
       case YY_MODE_PEER_CLIENT:
+        processBroadcastMessageList();
+        if(assetSync.isDue()) syncNextAsset();
         break;
       case YY_MODE_PEER_SERVER:
         dnsServer.processNextRequest();
@@ -270,14 +396,29 @@ uint8_t YoYoWiFiManager::loop() {
         break;
     }
 
+    updateScan();
+    scheduler.run();
+    updateManifest();
     setMode(updateTimeOuts());
+
+    //NB blocks until the image has been flashed - then restarts:
+    if(firmwareUpdate.isDue()) {
+      YY_LOGI("firmware update");
+      if(firmwareUpdate.update() == HTTP_UPDATE_FAILED) YY_LOGE("firmware update failed");
+    }
+
+    metrics.sampleHeap();
+    metrics.loop.add(micros() - startedAtUs);
   }
-  updateWifiLED();
+
+  #if defined(ESP32)
+    if(task) updateSnapshot();
+  #endif
 
   return(currentStatus);
 }
 
-void YoYoWiFiManager::updateWifiLED() {
+void YoYoWiFiManagerBase::updateWifiLED() {
   if(wifiLEDOn >= 0) {
     if(running) {
       bool blink = ((millis() / 1000) % 2) == 0;
@@ -300,31 +441,31 @@ void YoYoWiFiManager::updateWifiLED() {
   }
 }
 
-void YoYoWiFiManager::setWifiLED(bool value) {
+void YoYoWiFiManagerBase::setWifiLED(bool value) {
   if(this -> wifiLEDPin >= 0) {
     value = !(wifiLEDOn ^ value);
     digitalWrite(wifiLEDPin, value);
   }
 }
 
-bool YoYoWiFiManager::peerNetworkSet() {
+bool YoYoWiFiManagerBase::peerNetworkSet() {
   return(peerNetworkSSID[0] != NULL);
 }
 
-void YoYoWiFiManager::setMode(yy_mode_t mode, bool update) {
+void YoYoWiFiManagerBase::setMode(yy_mode_t mode, bool update) {
   nextMode = mode;
   if(update) updateMode();
 }
 
-bool YoYoWiFiManager::updateMode() {
+bool YoYoWiFiManagerBase::updateMode() {
   bool result = false;
 
-  if(activeRequests > 0) {
-    //waiting for activeRequests to complete
+  if(admission.getInFlight() > 0) {
+    //waiting for requests in flight to complete
     return(false);
   }
 
-  if(!broadcastMessageList.isNull() && broadcastMessageList.size() > 0) {
+  if(!broadcastQueue.isEmpty()) {
     //broadcast messages waiting to be sent
     return(false);
   }
@@ -332,12 +473,11 @@ bool YoYoWiFiManager::updateMode() {
   if(nextMode != currentMode) {
     delay(300);  //Allow any final transactions to complete before mode changes
 
-    char *currentModeString = new char[32];
-    char *nextModeString = new char[32];
+    char currentModeString[32];
+    char nextModeString[32];
     getModeAsString(currentMode, currentModeString);
     getModeAsString(nextMode, nextModeString);
-    Serial.printf("MODE:\t%s\t>\t%s\n", currentModeString, nextModeString);
-    delete currentModeString, nextModeString;
+    YY_LOGI("MODE:\t%s\t>\t%s", currentModeString, nextModeString);
 
     switch(nextMode) {
       case YY_MODE_NONE:
@@ -371,7 +511,7 @@ bool YoYoWiFiManager::updateMode() {
         break;
       case YY_MODE_CLIENT:
         WiFi.mode(WIFI_STA);
-        Serial.println("about to start server...");
+        YY_LOGD("about to start server...");
         if(startWebServerOnceConnected) startWebServer();
         else stopWebServer();
         updateClientTimeOut();
@@ -387,6 +527,7 @@ bool YoYoWiFiManager::updateMode() {
         delay(2000);
         startPeerNetworkAsAP();
         startWebServer();
+        scheduler.start(YY_TIMER_CLIENT_LIST, 0);
         break;
     }
     currentMode = nextMode;
@@ -398,7 +539,7 @@ bool YoYoWiFiManager::updateMode() {
   return(result);
 }
 
-void YoYoWiFiManager::printWiFiDiag() {
+void YoYoWiFiManagerBase::printWiFiDiag() {
   Serial.print("localIP: ");
   Serial.println(WiFi.localIP());
 
@@ -416,7 +557,7 @@ void YoYoWiFiManager::printWiFiDiag() {
   Serial.println("-");
 }
 
-void YoYoWiFiManager::getModeAsString(yy_mode_t mode, char *string) {
+void YoYoWiFiManagerBase::getModeAsString(yy_mode_t mode, char *string) {
   if(string != NULL) {
     switch(mode) {
       case YY_MODE_NONE:
@@ -435,11 +576,11 @@ void YoYoWiFiManager::getModeAsString(yy_mode_t mode, char *string) {
   }
 }
 
-char * YoYoWiFiManager::getStatusAsString(char *string) {
+char * YoYoWiFiManagerBase::getStatusAsString(char *string) {
   return(getStatusAsString(currentStatus, string));
 }
 
-char * YoYoWiFiManager::getStatusAsString(yy_status_t status, char *string) {
+char * YoYoWiFiManagerBase::getStatusAsString(yy_status_t status, char *string) {
   if(string != NULL) {
     switch(status) {
         strcpy(string, "YY_CONNECTED");
@@ -475,29 +616,68 @@ char * YoYoWiFiManager::getStatusAsString(yy_status_t status, char *string) {
   return(string);
 }
 
-bool YoYoWiFiManager::clientHasTimedOut() {
-  return(clientTimeOutAtMs > 0 && millis() > clientTimeOutAtMs);
+bool YoYoWiFiManagerBase::clientHasTimedOut() {
+  return(clientTimedOut);
 }
 
-void YoYoWiFiManager::updateClientTimeOut() {
-  if(clientTimeOutAtMs == 0 || clientHasTimedOut()) {
-    int timeoutMs = MIN_WIFICLIENTTIMEOUT + random(MIN_WIFICLIENTTIMEOUT);
-    clientTimeOutAtMs = millis() + timeoutMs;
+//Starts the time out unless it's already running - once it has run out it starts again:
+void YoYoWiFiManagerBase::updateClientTimeOut() {
+  if(!scheduler.isArmed(YY_TIMER_CLIENT_TIMEOUT)) {
+    clientTimedOut = false;
+    scheduler.start(YY_TIMER_CLIENT_TIMEOUT, MIN_WIFICLIENTTIMEOUT + random(MIN_WIFICLIENTTIMEOUT));
   }
 }
 
-bool YoYoWiFiManager::serverHasTimedOut() {
-  return(serverTimeOutAtMs > 0 && millis() > serverTimeOutAtMs);
+bool YoYoWiFiManagerBase::serverHasTimedOut() {
+  return(serverTimedOut);
 }
 
-void YoYoWiFiManager::updateServerTimeOut() {
-  if(serverTimeOutAtMs == 0 || serverHasTimedOut()) {
-    int timeoutMs = MIN_WIFISERVERTIMEOUT + random(MIN_WIFISERVERTIMEOUT);
-    serverTimeOutAtMs = millis() + timeoutMs;
+void YoYoWiFiManagerBase::updateServerTimeOut() {
+  if(!scheduler.isArmed(YY_TIMER_SERVER_TIMEOUT)) {
+    serverTimedOut = false;
+    scheduler.start(YY_TIMER_SERVER_TIMEOUT, MIN_WIFISERVERTIMEOUT + random(MIN_WIFISERVERTIMEOUT));
   }
 }
 
-YoYoWiFiManager::yy_mode_t YoYoWiFiManager::updateTimeOuts() {
+//Scheduled
+//=========
+
+void YoYoWiFiManagerBase::onWiFiMultiDue(void *manager) {
+  YoYoWiFiManagerBase *self = (YoYoWiFiManagerBase *) manager;
+  //WiFiMulti starts its own scans - and deletes the results - so leaves the radio alone while ours is running:
+  if(self -> currentMode != YY_MODE_PEER_SERVER && !self -> scan.isRunning()) self -> wifiMulti.run();
+}
+
+void YoYoWiFiManagerBase::onClientListDue(void *manager) {
+  ((YoYoWiFiManagerBase *) manager) -> updateClientList();
+}
+
+void YoYoWiFiManagerBase::onHTTPClientsDue(void *manager) {
+  ((YoYoWiFiManagerBase *) manager) -> httpClientPool.evictIdle();
+}
+
+void YoYoWiFiManagerBase::onWifiLEDDue(void *manager) {
+  ((YoYoWiFiManagerBase *) manager) -> updateWifiLED();
+}
+
+void YoYoWiFiManagerBase::onClientTimeOut(void *manager) {
+  ((YoYoWiFiManagerBase *) manager) -> clientTimedOut = true;
+}
+
+void YoYoWiFiManagerBase::onServerTimeOut(void *manager) {
+  ((YoYoWiFiManagerBase *) manager) -> serverTimedOut = true;
+}
+
+void YoYoWiFiManagerBase::onPeerElectionDue(void *manager) {
+  ((YoYoWiFiManagerBase *) manager) -> electPeerServer();
+}
+
+//How long loop() could wait before the next piece of periodic work is due:
+uint32_t YoYoWiFiManagerBase::getMsUntilNextDue() {
+  return(scheduler.getMsUntilNext());
+}
+
+YoYoWiFiManagerBase::yy_mode_t YoYoWiFiManagerBase::updateTimeOuts() {
   yy_mode_t mode = nextMode;
 
   //if we aren't waiting for a mode change:
@@ -524,23 +704,178 @@ YoYoWiFiManager::yy_mode_t YoYoWiFiManager::updateTimeOuts() {
   return(mode);
 }
 
+//Peer election
+//=============
+
+//Rather than waiting for a time out, the peer server is chosen from what a scan can see - the time outs are still there if it can't settle it.
+//Call before begin():
+void YoYoWiFiManagerBase::setPeerElection(bool election) {
+  peerElection = election;
+  electionIntervalMs = PEER_ELECTION_INTERVAL;
+
+  if(peerElection) scheduler.start(YY_TIMER_PEER_ELECTION, 0);
+  else scheduler.stop(YY_TIMER_PEER_ELECTION);
+}
+
+//Scans in the background - and once the results are in, changes mode if the election says so.
+//Each scan takes the radio off the peer network's channel for a second or so - while no other peer server is in sight the scans back off:
+void YoYoWiFiManagerBase::electPeerServer() {
+  bool connected = (currentStatus == YY_CONNECTED || currentStatus == YY_CONNECTED_PEER_CLIENT);
+
+  //anything else changing the mode starts the election over:
+  if(electionMode != currentMode) {
+    electionMode = currentMode;
+    electionIntervalMs = PEER_ELECTION_INTERVAL;
+  }
+  uint32_t nextMs = electionIntervalMs;
+
+  //only while not connected - or serving the peer network - and not already changing mode:
+  if(running && peerNetworkSet() && currentMode == nextMode && (currentMode == YY_MODE_PEER_SERVER || !connected)) {
+    if(!electionScanning) {
+      electionGeneration = scan.getGeneration();
+      electionScanning = scan.start();
+      if(electionScanning) nextMs = PEER_ELECTION_POLL;
+    }
+    else if(scan.isRunning()) {
+      nextMs = PEER_ELECTION_POLL;
+    }
+    else {
+      electionScanning = false;
+
+      //no new results if the scan failed:
+      if(scan.getGeneration() != electionGeneration) {
+        bool rivalFound = false;
+        yy_mode_t mode = getElectedMode(&rivalFound);
+
+        if(mode != currentMode) setMode(mode);
+        else if(!rivalFound) electionIntervalMs = min(electionIntervalMs * 2, (uint32_t) PEER_ELECTION_MAX_INTERVAL);
+        else electionIntervalMs = PEER_ELECTION_INTERVAL;
+        nextMs = electionIntervalMs;
+      }
+    }
+  }
+  else electionScanning = false;
+
+  if(peerElection) scheduler.start(YY_TIMER_PEER_ELECTION, nextMs);
+}
+
+//Peer servers are ranked by their soft AP's MAC - like the chip ID it's unique to each chip, and it's what the beacons carry as the BSSID.
+//With no peer network (or known network) in sight this becomes a peer server, and every peer server but the highest ranked joins that one.
+//rivalFound is set if another peer server is in sight:
+YoYoWiFiManagerBase::yy_mode_t YoYoWiFiManagerBase::getElectedMode(bool *rivalFound) {
+  yy_mode_t mode = currentMode;
+  bool peerNetworkFound = false;
+  bool knownNetworkFound = false;
+  bool outranked = false;
+
+  uint8_t rank[6];
+  WiFi.softAPmacAddress(rank);
+
+  yy_network_t network;
+  uint32_t generation = scan.getGeneration();
+  for(int n = 0; scan.get(n, &network, generation); ++n) {
+    if(strcmp(network.ssid, peerNetworkSSID) == 0) {
+      peerNetworkFound = true;
+      if(memcmp(network.bssid, rank, sizeof(rank)) != 0) *rivalFound = true;
+      if(memcmp(network.bssid, rank, sizeof(rank)) > 0) outranked = true;
+    }
+    else if(settings && settings -> getNetwork(network.ssid) >= 0) {
+      knownNetworkFound = true;
+    }
+  }
+
+  if(currentMode == YY_MODE_PEER_SERVER) {
+    if(outranked) {
+      YY_LOGI("peer election: outranked - joining the peer network");
+      mode = YY_MODE_PEER_CLIENT;
+    }
+  }
+  else if(!peerNetworkFound && !knownNetworkFound) {
+    YY_LOGI("peer election: no peer network - starting one");
+    mode = YY_MODE_PEER_SERVER;
+  }
+
+  return(mode);
+}
+
 //AsyncWebHandler
 //===============
 
-bool YoYoWiFiManager::canHandle(AsyncWebServerRequest *request) {
-  //we can handle anything!
-  return true;
+bool YoYoWiFiManagerBase::canHandle(AsyncWebServerRequest *request) {
+  //headers are discarded unless asked for:
+  request->addInterestingHeader("Range");
+  request->addInterestingHeader("If-Range");
+
+  //we can handle anything - as long as there's room for it:
+  yy_request_class_t requestClass = getRequestClass(request);
+  bool admitted = false;
+
+  if(ESP.getFreeHeap() < config.minFreeHeapBytes) admission.refuse(requestClass);
+  else admitted = admission.admit(request, requestClass);
+
+  if(admitted) {
+    request->onDisconnect([this, request]() {
+      endRequest(request);
+    });
+  }
+
+  return(admitted);
+}
+
+//Decided as handleRequest() would route it:
+yy_request_class_t YoYoWiFiManagerBase::getRequestClass(AsyncWebServerRequest *request) {
+  yy_request_class_t result = YY_REQUEST_STATIC;
+  int route = findRoute(request->url().c_str(), request->method());
+
+  //a transfer holds its connection for as long as it takes - so it mustn't take a slot a page needs:
+  if((route == YY_ROUTE_FIRMWARE && request->method() == HTTP_GET) || route == YY_ROUTE_ASSET) {
+    result = YY_REQUEST_TRANSFER;
+  }
+  else if(route != YY_ROUTE_NOT_FOUND || request->url().startsWith("/yoyo")) {
+    result = YY_REQUEST_API;
+  }
+  else if(currentMode == YY_MODE_PEER_SERVER && !(SPIFFS_ENABLED && SPIFFS.exists(request->url()))) {
+    result = YY_REQUEST_CAPTIVE;
+  }
+
+  return(result);
+}
+
+//Once a request's connection has closed - whether or not its response was sent in full:
+void YoYoWiFiManagerBase::endRequest(AsyncWebServerRequest *request) {
+  switch(admission.end(request)) {
+    case YY_TRANSFER_FIRMWARE:
+      firmwareUpdate.endTransfer();
+      break;
+    case YY_TRANSFER_ASSET:
+      if(assetTransfers > 0) assetTransfers--;
+      break;
+  }
+
+  if(fileUpload.isOwner(request)) fileUpload.abort();
 }
 
-void YoYoWiFiManager::handleRequest(AsyncWebServerRequest *request) {
-  Serial.print("handleRequest: ");
-  Serial.println(request->url());
+void YoYoWiFiManagerBase::handleRequest(AsyncWebServerRequest *request) {
+  uint32_t startedAtUs = micros();
+  YY_LOGD("handleRequest: %s", request->url().c_str());
 
-  activeRequests++;
+  int route = findRoute(request->url().c_str(), request->method());
 
   if (request->method() == HTTP_GET) {
-    if(request->url().startsWith("/yoyo")) {
-      onYoYoRequestGET(request);
+    if(route == YY_ROUTE_FIRMWARE) {
+      sendFirmware(request);
+    }
+    else if(route == YY_ROUTE_ASSET) {
+      sendAsset(request);
+    }
+    else if(route == YY_ROUTE_METRICS) {
+      sendMetrics(request);
+    }
+    else if(route == YY_ROUTE_LOGS) {
+      sendLogs(request);
+    }
+    else if(route != YY_ROUTE_NOT_FOUND || request->url().startsWith("/yoyo")) {
+      onYoYoRequestGET(request, route);
     }
     else if (SPIFFS_ENABLED && SPIFFS.exists(request->url())) {
       sendFile(request, request->url());
@@ -559,16 +894,23 @@ void YoYoWiFiManager::handleRequest(AsyncWebServerRequest *request) {
     }
   }
   else if (request->method() == HTTP_POST) {
-    request->send(400); //POSTs are expected to have a body and then be processes by handleBody()
+    if(route == YY_ROUTE_UPLOAD) {
+      onYoYoRequestUPLOAD(request);  //the file has already been written by handleUpload() or handleBody()
+    }
+    else {
+      request->send(400); //POSTs are expected to have a body and then be processes by handleBody()
+    }
   }
   else {
     request->send(400);
   }
 
-  activeRequests--;
+  metrics.request(route, micros() - startedAtUs);
 }
 
-void YoYoWiFiManager::handleCaptivePortalRequest(AsyncWebServerRequest *request) {
+void YoYoWiFiManagerBase::handleCaptivePortalRequest(AsyncWebServerRequest *request) {
+    metrics.captivePortalRequests++;
+
     if (request->url().endsWith(".html") || 
               request->url().endsWith("/") ||
               request->url().endsWith("generate_204") ||
@@ -580,7 +922,7 @@ void YoYoWiFiManager::handleCaptivePortalRequest(AsyncWebServerRequest *request)
       request->send(200, "text/plain", "Microsoft NCSI");
     }
     else if (strstr(request->url().c_str(), "generate_204_") != NULL) {
-      Serial.println("you must be huawei!");
+      YY_LOGD("you must be huawei!");
       sendIndexFile(request);
     }
     else {
@@ -588,18 +930,22 @@ void YoYoWiFiManager::handleCaptivePortalRequest(AsyncWebServerRequest *request)
     }
 }
 
-void YoYoWiFiManager::handleBody(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total) {
-  Serial.print("handleBody: ");
-  Serial.println(request->url());
+void YoYoWiFiManagerBase::handleBody(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total) {
+  uint32_t startedAtUs = micros();
+  YY_LOGD("handleBody: %s", request->url().c_str());
 
-  activeRequests++;
+  int route = findRoute(request->url().c_str(), request->method());
 
   if (request->method() == HTTP_GET) {
     request->send(400); //GETs are expected to have no body and then be processes by handleRequest()
   }
   else if (request->method() == HTTP_POST) {
-    if(request->url().startsWith("/yoyo")) {
-      onYoYoRequestPOST(data, len, request);
+    if(route == YY_ROUTE_UPLOAD) {
+      //a raw (rather than multipart) upload - the body is the file:
+      writeUpload(request, request->hasParam("path") ? request->getParam("path")->value() : "", index, data, len, index + len == total);
+    }
+    else if(route != YY_ROUTE_NOT_FOUND || request->url().startsWith("/yoyo")) {
+      onYoYoRequestPOST(data, len, request, route);
     }
     else request->send(404);
   }
@@ -613,195 +959,1071 @@ void YoYoWiFiManager::handleBody(AsyncWebServerRequest * request, uint8_t *data,
     request->send(400);
   }
 
-  activeRequests--;
+  metrics.request(route, micros() - startedAtUs);
+}
+
+void YoYoWiFiManagerBase::handleUpload(AsyncWebServerRequest *request, const String& filename, size_t index, uint8_t *data, size_t len, bool final) {
+  if(findRoute(request->url().c_str(), request->method()) == YY_ROUTE_UPLOAD) {
+    writeUpload(request, request->hasParam("path") ? request->getParam("path")->value() : filename, index, data, len, final);
+  }
 }
 
-void YoYoWiFiManager::sendFile(AsyncWebServerRequest * request, String path) {
-  Serial.println("handleFileRead: " + path);
+void YoYoWiFiManagerBase::sendFile(AsyncWebServerRequest * request, String path) {
+  YY_LOGD("handleFileRead: %s", path.c_str());
 
   if (SPIFFS_ENABLED && SPIFFS.exists(path)) {
-    request->send(SPIFFS, path, getMimeType(path));
+    String mimeType = getMimeType(path);
+
+    if(templateVariableCount > 0 && mimeType == "text/html") {
+      //placeholders are substituted as the file streams out - freed with the response, however it ends:
+      std::shared_ptr<YoYoTemplateFile> templateFile = std::make_shared<YoYoTemplateFile>(SPIFFS.open(path, "r"), [this](const char *name, String &result) { return processTemplate(name, result); });
+      request->send(request->beginChunkedResponse(mimeType, [templateFile](uint8_t *buffer, size_t maxLength, size_t index) -> size_t {
+        return(templateFile -> fill(buffer, maxLength));
+      }));
+    }
+    else {
+      File file = SPIFFS.open(path, "r");
+      size_t size = file.size();
+      size_t start, length;
+
+      //changes whenever a file is uploaded - or the device restarts:
+      char etag[20];
+      sprintf(etag, "\"%08x-%x\"", (unsigned int) fileSystemGeneration, (unsigned int) size);
+
+      AsyncWebServerResponse *response = NULL;
+
+      switch(getRange(request, etag, size, &start, &length)) {
+        case 206:
+          //the file is opened once for the response and read as it's sent:
+          file.seek(start);
+          response = request->beginResponse(mimeType, length, [file, length](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t {
+            return(file.read(buffer, (length - index < maxLen) ? length - index : maxLen));
+          });
+          response->setCode(206);
+          response->addHeader("Content-Range", "bytes " + String(start) + "-" + String(start + length - 1) + "/" + String(size));
+          break;
+        case 416:
+          file.close();
+          response = request->beginResponse(416);
+          response->addHeader("Content-Range", "bytes */" + String(size));
+          break;
+        default:
+          response = request->beginResponse(file, path, mimeType);
+          break;
+      }
+
+      response->addHeader("Accept-Ranges", "bytes");
+      response->addHeader("ETag", etag);
+      request->send(response);
+    }
   }
   else {
     request->send(404);
   }
 }
 
-void YoYoWiFiManager::setRootIndexFile(String rootIndexFile) {
-  this -> rootIndexFile = rootIndexFile;
-}
+//Reads a single "bytes=" Range (with any If-Range) and returns 206 with the part of the file to send, 416 if it lies outside the file - or 200 to send the whole file
+int YoYoWiFiManagerBase::getRange(AsyncWebServerRequest *request, const char *etag, size_t size, size_t *start, size_t *length) {
+  int httpResponseCode = 200;
+  *start = 0;
+  *length = size;
 
-void YoYoWiFiManager::sendIndexFile(AsyncWebServerRequest * request) {
-  if (SPIFFS_ENABLED && SPIFFS.exists(rootIndexFile)) {
-    sendFile(request, rootIndexFile);
-  }
-  else {
-    request->send(200, "text/html", DEFAULT_INDEX_HTML);
-  }
-}
+  AsyncWebHeader *range = request->getHeader("Range");
+  AsyncWebHeader *ifRange = request->getHeader("If-Range");
 
-String YoYoWiFiManager::getMimeType(String filename) {
-  if (filename.endsWith(".htm")) return "text/html";
-  else if (filename.endsWith(".html")) return "text/html";
-  else if (filename.endsWith(".css")) return "text/css";
-  else if (filename.endsWith(".js")) return "application/javascript";
-  else if (filename.endsWith(".png")) return "image/png";
-  else if (filename.endsWith(".gif")) return "image/gif";
-  else if (filename.endsWith(".jpg")) return "image/jpeg";
-  else if (filename.endsWith(".ico")) return "image/x-icon";
-  else if (filename.endsWith(".svg")) return "image/svg+xml";
-  else if (filename.endsWith(".xml")) return "text/xml";
-  else if (filename.endsWith(".pdf")) return "application/x-pdf";
-  else if (filename.endsWith(".zip")) return "application/x-zip";
-  else if (filename.endsWith(".gz")) return "application/x-gzip";
-  else if (filename.endsWith(".json")) return "application/json";
-  return "text/plain";
-}
+  //part of a file that has since changed is no use - and multiple ranges aren't supported - either way the whole file is sent:
+  if(range && (!ifRange || ifRange->value().equals(etag)) && range->value().startsWith("bytes=") && range->value().indexOf(',') < 0) {
+    const char *value = range->value().c_str() + 6;
+    char *end;
 
-void YoYoWiFiManager::onYoYoRequestGET(AsyncWebServerRequest *request) {
-  if (request->url().equals("/yoyo/networks"))         getNetworks(request);
-  else if (request->url().equals("/yoyo/clients"))     getClients(request);
-  else if (request->url().equals("/yoyo/peers"))       getPeers(request);
-  else if (request->url().equals("/yoyo/credentials")) getCredentials(request);
-  else onYoYoMessageGET(request);
-}
+    if(*value == '-') {
+      //the last n bytes:
+      unsigned long n = strtoul(value + 1, &end, 10);
 
-void YoYoWiFiManager::onYoYoMessageGET(AsyncWebServerRequest *request) {
-  bool success = false;
+      if(end != value + 1 && *end == '\0') {
+        if(n == 0 || size == 0) {
+          httpResponseCode = 416;
+        }
+        else {
+          *length = (n < size) ? n : size;
+          *start = size - *length;
+          httpResponseCode = 206;
+        }
+      }
+    }
+    else {
+      //from first to last (or the end of the file):
+      unsigned long first = strtoul(value, &end, 10);
 
-  DynamicJsonDocument message(1024);
-  if(yoYoCommandGetHandler) {
-    message["path"] = (char *) request->url().c_str();
-    success = yoYoCommandGetHandler(message.as<JsonVariant>());
-    serializeJson(message, Serial);
-    Serial.println();
+      if(end != value && *end == '-') {
+        const char *lastValue = end + 1;
+        unsigned long last = (*lastValue == '\0') ? ULONG_MAX : strtoul(lastValue, &end, 10);
+
+        if((*lastValue == '\0' || *end == '\0') && first <= last) {
+          if(first >= size) {
+            httpResponseCode = 416;
+          }
+          else {
+            if(last >= size) last = size - 1;
+            *start = first;
+            *length = last - first + 1;
+            httpResponseCode = 206;
+          }
+        }
+      }
+    }
   }
 
-  if(success) {
-    AsyncResponseStream *response = request->beginResponseStream("application/json");
+  return(httpResponseCode);
+}
+
+//Shares the firmware image at path with the peer network - every peer fetches it from here and flashes it, a few at a time
+bool YoYoWiFiManagerBase::distributeFirmware(const char *path) {
+  bool success = false;
 
-    if(!message["payload"].isNull()) {
-      response->print(message["payload"].as<String>());
+  #if defined(ESP32)
+    if(isOtherTask()) {
+      StaticJsonDocument<JSON_OBJECT_SIZE(1)> message;
+      message.to<JsonObject>();
+      taskFirmwarePath = path;  //kept - like the path given to share()
+      return(pushIntent(YY_INTENT_DISTRIBUTE_FIRMWARE, message.as<JsonVariant>(), IPAddress()));
     }
-    else response->print("{}");
+  #endif
 
-    request->send(response);
-  }
-  else {
-    request->send(400);
+  //only the peer server - peers don't take firmware from anyone else:
+  if(config.fileTransfer && SPIFFS_ENABLED && currentMode == YY_MODE_PEER_SERVER && firmwareUpdate.share(path)) {
+    YY_LOGI("distributing firmware: %s (%s)", path, firmwareUpdate.getMD5());
+
+    DynamicJsonDocument message(256);
+    setMessagePath(message.as<JsonVariant>(), YY_ROUTE_FIRMWARE, YY_FIRMWARE_URI);
+    message["method"] = "POST";
+    message["payload"]["host"] = WiFi.softAPIP().toString();
+    message["payload"]["port"] = webServerPort;
+    message["payload"]["md5"] = firmwareUpdate.getMD5();
+    message["payload"]["size"] = firmwareUpdate.getSize();
+
+    addBroadcastMessage(message.as<JsonVariant>(), IPAddress(0, 0, 0, 0));
+    success = true;
   }
-} 
-
-void YoYoWiFiManager::onYoYoRequestPOST(uint8_t *data, size_t len, AsyncWebServerRequest *request) {
-  if(request -> contentType().equals("application/json")){
-    //TODO: this limit seems artificial
-    char *json = new char[1024];
-    len = min(len, (unsigned int) 1024-1);
-    int i = 0;
-    for (; i < len; i++)  json[i] = char(data[i]);
-    json[i+1] = '\0';
-
-    DynamicJsonDocument message(1024);
-    DynamicJsonDocument payload(1024);
-    //NB cast to (const char*) forces a copy by value as will shortly delete json object:
-    if(deserializeJson(payload, (const char*)json) == DeserializationError::Ok) {
-      message["payload"] = payload;
-      message["path"] = (char *) request->url().c_str();
-      message["method"] = "POST";
 
-      onYoYoMessagePOST(message.as<JsonVariant>(), request);
-    }
+  return(success);
+}
+
+bool YoYoWiFiManagerBase::isFirmwareUpdatePending() {
+  return(firmwareUpdate.isPending());
+}
 
-    delete json;
+//The image is only sent to a few peers at a time - the rest are asked to come back later:
+void YoYoWiFiManagerBase::sendFirmware(AsyncWebServerRequest *request) {
+  if(!SPIFFS_ENABLED || !firmwareUpdate.isShared()) {
+    request->send(404);
   }
-  else if(request -> contentType().equals("multipart/form-data")) {
-    //FILE UPLOAD
-    request->send(200);
+  else if(!firmwareUpdate.beginTransfer()) {
+    sendUnavailable(request, YY_FIRMWARE_RETRY_MIN_MS / 1000);
   }
   else {
-    Serial.printf("unknown content type: %s\n", request -> contentType().c_str());
-    request->send(400);
+    admission.setTransfer(request, YY_TRANSFER_FIRMWARE);
+
+    //the updater checks the image against x-MD5 before it will boot from it:
+    AsyncWebServerResponse *response = request->beginResponse(SPIFFS, firmwareUpdate.getPath(), "application/octet-stream");
+    response->addHeader("x-MD5", firmwareUpdate.getMD5());
+    request->send(response);
   }
 }
 
-void YoYoWiFiManager::onYoYoRequestUPLOAD(uint8_t *data, size_t len, AsyncWebServerRequest *request) {
-  if (request->url().equals("/yoyo/upload")) {
-    request->send(200);
+//{"host", "port", "md5", "size"} - an image to fetch and flash
+//Firmware is only taken from the peer server, and only as a broadcast it has passed on - otherwise anyone on the peer network
+//(or the captive portal) could have every peer flash an image of their choosing:
+bool YoYoWiFiManagerBase::isFirmwareSource(JsonVariant payload, IPAddress sender) {
+  return(currentMode == YY_MODE_PEER_CLIENT && YoYoFirmwareUpdate::isSource(payload["host"] | "", sender, WiFi.gatewayIP()));
+}
+
+bool YoYoWiFiManagerBase::onFirmwareMessage(JsonVariant payload) {
+  return(firmwareUpdate.schedule(payload["host"], payload["port"] | 80, payload["md5"]));
+}
+
+//Keeps the manifest up to date a slice at a time - requests for it are asked to come back until it is:
+void YoYoWiFiManagerBase::updateManifest() {
+  if(config.fileTransfer && SPIFFS_ENABLED) {
+    manifest.update(fileSystemGeneration, firmwareUpdate.isShared() ? firmwareUpdate.getPath() : NULL);
   }
-  else {
+}
+
+//Built by loop() - never here. Returns 503 until it's ready:
+int YoYoWiFiManagerBase::printManifest(Print &response) {
+  YoYoManifest::json_t json = manifest.get(fileSystemGeneration);
+  if(json) response.print(*json);
+
+  return(json ? 200 : 503);
+}
+
+//Only a few peers are sent files at a time - the rest are asked to come back later:
+void YoYoWiFiManagerBase::sendAsset(AsyncWebServerRequest *request) {
+  String path = request->hasParam("path") ? request->getParam("path")->value() : "";
+
+  if(!SPIFFS_ENABLED || path.length() == 0 || !SPIFFS.exists(path)) {
     request->send(404);
   }
+  else if(assetTransfers >= config.assetTransfers) {
+    sendUnavailable(request, YY_ASSET_RETRY_MS / 1000);
+  }
+  else {
+    assetTransfers++;
+    admission.setTransfer(request, YY_TRANSFER_ASSET);
+
+    request->send(SPIFFS, path, "application/octet-stream");
+  }
 }
 
-void YoYoWiFiManager::onYoYoMessagePOST(JsonVariant message, AsyncWebServerRequest *request) {
+//Compares the files here with the peer server's and fetches any that differ - one each loop()
+bool YoYoWiFiManagerBase::syncAssets() {
   bool success = false;
-  Serial.println("onYoYoMessagePOST: " + message["path"].as<String>());
 
-  if (message["path"] == "/yoyo/broadcast") {
-    //TODO: request to broadcast a message from a peer - 404 unless YY_MODE_PEER_SERVER
-  }
-  else if (message["path"] == "/yoyo/credentials") {
-    if(setCredentials(message["payload"], request)) {
-      message["broadcast"] = true;
-      connect();  //this requests YY_MODE_CLIENT mode - which will be accessed on next loop() call
+  #if defined(ESP32)
+    if(isOtherTask()) {
+      StaticJsonDocument<JSON_OBJECT_SIZE(1)> message;
+      message.to<JsonObject>();
+      return(pushIntent(YY_INTENT_SYNC_ASSETS, message.as<JsonVariant>(), IPAddress()));
+    }
+  #endif
+
+  if(config.fileTransfer && currentMode == YY_MODE_PEER_CLIENT && SPIFFS_ENABLED) {
+    DynamicJsonDocument remote(YY_ASSET_MANIFEST_MAX_BYTES);
 
+    if(GET(WiFi.gatewayIP().toString().c_str(), YY_MANIFEST_URI, remote) == 200) {
+      //in loop() - so it's fine to finish the local manifest here and now:
+      manifest.build(fileSystemGeneration, firmwareUpdate.isShared() ? firmwareUpdate.getPath() : NULL);
+      DynamicJsonDocument local(YY_ASSET_MANIFEST_MAX_BYTES);
+      YoYoManifest::json_t localManifest = manifest.get(fileSystemGeneration);
+      if(localManifest) deserializeJson(local, *localManifest);
+
+      assetSync.clear();
+      for(JsonPair file : remote.as<JsonObject>()) {
+        const char *md5 = file.value().as<const char *>();
+        const char *localMD5 = local[file.key().c_str()];
+
+        if(md5 && (!localMD5 || strcmp(localMD5, md5) != 0)) {
+          if(!assetSync.add(file.key().c_str(), md5)) YY_LOGW("can't sync: %s", file.key().c_str());
+        }
+      }
+      YY_LOGI("syncing %i files", assetSync.getTotal());
       success = true;
     }
   }
-  else {
-    if(yoYoCommandPostHandler) {
-      success = yoYoCommandPostHandler(message);
+
+  return(success);
+}
+
+bool YoYoWiFiManagerBase::isAssetSyncPending() {
+  return(assetSync.isPending());
+}
+
+void YoYoWiFiManagerBase::setAssetSyncHandler(assetSyncCallbackPtr onAssetSynchandler) {
+  this -> onAssetSynchandler = onAssetSynchandler;
+}
+
+//Streams the next file from the peer server to a temporary file - it only replaces the existing file once its MD5 matches the manifest
+void YoYoWiFiManagerBase::syncNextAsset() {
+  const char *path = assetSync.getPath();
+  int httpResponseCode = -1;
+  bool success = false;
+  bool retryable = true;
+
+  //the upload slot is shared with /yoyo/upload:
+  if(fileUpload.begin(this, path)) {
+    String uri = String(YY_ASSET_URI) + "?path=" + path;
+    HTTPClient *http = httpClientPool.acquire(WiFi.gatewayIP().toString().c_str(), uri.c_str());
+
+    if(http) {
+      size_t consumed = 0;
+      httpResponseCode = http -> GET();
+
+      if(httpResponseCode == 200 && http -> getSize() >= 0) {
+        WiFiClient *stream = http -> getStreamPtr();
+        int remaining = http -> getSize();
+        uint8_t buffer[256];
+
+        while(remaining > 0) {
+          size_t n = stream -> readBytes(buffer, (remaining < (int) sizeof(buffer)) ? remaining : sizeof(buffer));
+          if(n == 0) break;
+          consumed += n;
+          if(!fileUpload.write(buffer, n)) break;
+          remaining -= n;
+        }
+        success = (remaining == 0 && fileUpload.end(assetSync.getMD5()));
+        retryable = !fileUpload.isCorrupt();
+      }
+      else if(httpResponseCode == 404) {
+        retryable = false;
+      }
+      httpClientPool.release(http, httpResponseCode > 0 && httpClientPool.drain(http, consumed));
     }
-    request->send(success ? 200 : 404);
+
+    if(success) fileSystemGeneration++;
+    else fileUpload.abort();
+    fileUpload.release();
   }
-  //when the response is sent, the client is closed and freed from the memory
 
-  if(success) {
-    if(currentMode == YY_MODE_PEER_SERVER && message["broadcast"] == true) {
-      addBroadcastMessage(message);
-    }
+  //busy - here or at the peer server - is worth another try:
+  if(success || !retryable || !assetSync.retry()) {
+    YY_LOGI("sync %s: %s", success ? "OK" : "FAILED", path);
+    if(onAssetSynchandler) onAssetSynchandler(path, success, assetSync.getDone() + 1, assetSync.getTotal());
+    assetSync.advance(success);
   }
 }
 
-void YoYoWiFiManager::addBroadcastMessage(JsonVariant message) {
-  if(currentMode == YY_MODE_PEER_SERVER) {
-    broadcastMessageList.add(message);
-  }
+void YoYoWiFiManagerBase::setRootIndexFile(String rootIndexFile) {
+  this -> rootIndexFile = rootIndexFile;
 }
 
-void YoYoWiFiManager::processBroadcastMessageList() {
-  if(!broadcastMessageList.isNull() && broadcastMessageList.size() > 0) {
-    broadcastMessage(broadcastMessageList[0]);
-    broadcastMessageList.remove(0);
+//NB name and path are not copied - they must remain valid (string literals, for example)
+bool YoYoWiFiManagerBase::addTemplateVariable(const char *name, const char *path) {
+  bool success = false;
+
+  //only letters, digits and _ are recognised between the % signs:
+  if(name && path && YoYoTemplateFile::isName(name) && templateVariableCount < TEMPLATE_VARIABLES_MAX) {
+    templateVariables[templateVariableCount].name = name;
+    templateVariables[templateVariableCount].path = path;
+    templateVariableCount++;
+    success = true;
   }
+
+  return(success);
 }
 
-bool YoYoWiFiManager::broadcastMessage(JsonVariant message) {
-  bool result = false;
+//Sets result to the JSON for a %NAME% placeholder - from a GET of its path - or returns false if it isn't one of ours
+bool YoYoWiFiManagerBase::processTemplate(const char *name, String &result) {
+  bool found = false;
 
-  if(currentMode == YY_MODE_PEER_SERVER) {
-    int peerCount = countPeers();
+  for(int n = 0; n < templateVariableCount && !found; ++n) {
+    if(strcmp(name, templateVariables[n].name) == 0) {
+      const char *path = templateVariables[n].path;
+      StreamString json;
 
-    if(peerCount > 0) {
-      result = true;
-      IPAddress *ipAddress = new IPAddress();
-      for (int i = 0; i < peerCount; i++) {
-        getPeerN(i, ipAddress, NULL);
-        if(message["method"] == "POST") POST(ipAddress -> toString().c_str(), message["path"], message["payload"]);
-        //TODO: consider the other method types
+      if(beginRequestArena() && onYoYoMessageGET(findRoute(path, HTTP_GET), path, json) == 200) {
+        //keep a string like "</script>" from closing the script block it's injected into:
+        json.replace("</", "<\\/");
+        result = json;
       }
-      delete ipAddress;
+      else {
+        result = "null";
+      }
+      endRequestArena();
+      found = true;
     }
   }
 
-  return(result);
+  return(found);
 }
 
-void YoYoWiFiManager::onYoYoRequestDELETE(uint8_t *data, size_t len, AsyncWebServerRequest *request) {
-  //TODO fix this!
+void YoYoWiFiManagerBase::sendIndexFile(AsyncWebServerRequest * request) {
+  if (SPIFFS_ENABLED && SPIFFS.exists(rootIndexFile)) {
+    sendFile(request, rootIndexFile);
+  }
+  else {
+    request->send(200, "text/html", DEFAULT_INDEX_HTML);
+  }
+}
 
-  //TODO: this limit seems artificial
-  // char *json = new char[1024];
+String YoYoWiFiManagerBase::getMimeType(String filename) {
+  if (filename.endsWith(".htm")) return "text/html";
+  else if (filename.endsWith(".html")) return "text/html";
+  else if (filename.endsWith(".css")) return "text/css";
+  else if (filename.endsWith(".js")) return "application/javascript";
+  else if (filename.endsWith(".png")) return "image/png";
+  else if (filename.endsWith(".gif")) return "image/gif";
+  else if (filename.endsWith(".jpg")) return "image/jpeg";
+  else if (filename.endsWith(".ico")) return "image/x-icon";
+  else if (filename.endsWith(".svg")) return "image/svg+xml";
+  else if (filename.endsWith(".xml")) return "text/xml";
+  else if (filename.endsWith(".pdf")) return "application/x-pdf";
+  else if (filename.endsWith(".zip")) return "application/x-zip";
+  else if (filename.endsWith(".gz")) return "application/x-gzip";
+  else if (filename.endsWith(".json")) return "application/json";
+  return "text/plain";
+}
+
+void YoYoWiFiManagerBase::onYoYoRequestGET(AsyncWebServerRequest *request, int route) {
+  if(beginRequestArena()) {
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+
+    sendResponse(request, response, onYoYoMessageGET(route, request->url().c_str(), *response));
+    endRequestArena();
+  }
+  else sendUnavailable(request, 1);
+}
+
+//Prints the JSON response to response and returns 200 - or returns an error code having printed nothing
+int YoYoWiFiManagerBase::onYoYoMessageGET(int route, const char *path, Print &response) {
+  int httpResponseCode = 200;
+
+  switch(route) {
+    case YY_ROUTE_METHOD_NOT_ALLOWED:
+      httpResponseCode = 405;
+      break;
+    case YY_ROUTE_NETWORKS:
+    case YY_ROUTE_CLIENTS:
+    case YY_ROUTE_PEERS:
+    case YY_ROUTE_CREDENTIALS:
+      printResponse(route, response);
+      break;
+    case YY_ROUTE_MANIFEST:
+      httpResponseCode = printManifest(response);
+      break;
+    case YY_ROUTE_FIRMWARE:
+    case YY_ROUTE_ASSET:
+    case YY_ROUTE_METRICS:
+    case YY_ROUTE_LOGS:
+      httpResponseCode = 400; //files, metrics and logs aren't JSON
+      break;
+    default: {
+      //a route added with on() - or any other /yoyo path, for the GET handler passed to init():
+      bool success = false;
+
+      YoYoArenaJsonDocument message(config.documentBytes, requestAllocator());
+      setMessagePath(message.as<JsonVariant>(), route, path);
+      message["method"] = "GET";
+
+      routeCallbackPtr handler = routes.getHandler(route);
+      if(handler)                     success = handler(route, message.as<JsonVariant>());
+      else if(yoYoCommandGetHandler)  success = yoYoCommandGetHandler(message.as<JsonVariant>());
+
+      if(success) {
+        if(!message["payload"].isNull()) {
+          serializeJson(message["payload"], response);
+        }
+        else response.print("{}");
+      }
+      else httpResponseCode = 400;
+      break;
+    }
+  }
+
+  return(httpResponseCode);
+}
+
+//Service Unavailable - with when to try again:
+void YoYoWiFiManagerBase::sendUnavailable(AsyncWebServerRequest *request, int retryAfterS) {
+  AsyncWebServerResponse *response = request->beginResponse(503);
+  response->addHeader("Retry-After", String(retryAfterS));
+  request->send(response);
+}
+
+//Takes an arena for the JSON documents of the request in hand - returns false if none is free:
+bool YoYoWiFiManagerBase::beginRequestArena() {
+  if(requestArenaDepth == 0) requestArena = jsonArenas.acquire();
+  if(requestArena) requestArenaDepth++;
+
+  return(requestArena != NULL);
+}
+
+void YoYoWiFiManagerBase::endRequestArena() {
+  if(requestArenaDepth > 0 && --requestArenaDepth == 0) {
+    jsonArenas.release(requestArena);
+    requestArena = NULL;
+  }
+}
+
+//Documents made with this allocator take their memory from the request's arena - or the heap, outside of a request
+YoYoArenaAllocator YoYoWiFiManagerBase::requestAllocator() {
+  return(YoYoArenaAllocator(requestArena));
+}
+
+size_t YoYoWiFiManagerBase::getJsonArenaHighWaterBytes() {
+  return(jsonArenas.getHighWaterBytes());
+}
+
+uint32_t YoYoWiFiManagerBase::getJsonArenaExhaustedCount() {
+  return(jsonArenas.getExhaustedCount());
+}
+
+uint32_t YoYoWiFiManagerBase::getJsonArenaOverflowCount() {
+  return(jsonArenas.getOverflowCount());
+}
+
+//With the gauges brought up to date:
+YoYoMetrics &YoYoWiFiManagerBase::getMetrics() {
+  for(int n = 0; n < YY_REQUEST_CLASSES; ++n) {
+    metrics.inFlightRequests[n] = admission.getInFlight((yy_request_class_t) n);
+    metrics.shedRequests[n] = admission.getShed((yy_request_class_t) n);
+  }
+  metrics.broadcastQueueDepth = broadcastQueue.size();
+  metrics.broadcastQueueHighWater = broadcastQueue.getHighWater();
+  metrics.sampleHeap();
+  metrics.sampleLargestFreeBlock();
+
+  return(metrics);
+}
+
+//In Prometheus text format:
+void YoYoWiFiManagerBase::sendMetrics(AsyncWebServerRequest *request) {
+  AsyncResponseStream *response = request->beginResponseStream("text/plain; version=0.0.4");
+  getMetrics().print(*response, routes);
+  scheduler.print(*response);
+  request->send(response);
+}
+
+//The most recent log messages, oldest first:
+void YoYoWiFiManagerBase::sendLogs(AsyncWebServerRequest *request) {
+  AsyncResponseStream *response = request->beginResponseStream("text/plain");
+  yyLog().print(*response);
+  request->send(response);
+}
+
+//Log messages are kept for /yoyo/logs either way:
+void YoYoWiFiManagerBase::setSerialLogging(bool serial) {
+  yyLog().setSerial(serial);
+}
+
+void YoYoWiFiManagerBase::sendResponse(AsyncWebServerRequest *request, AsyncResponseStream *response, int httpResponseCode) {
+  if(httpResponseCode == 200) {
+    request->send(response);
+  }
+  else if(httpResponseCode == 503) {
+    //not ready yet - e.g. the manifest:
+    delete response;
+    sendUnavailable(request, 1);
+  }
+  else {
+    delete response;
+    request->send(httpResponseCode);
+  }
+}
+
+void YoYoWiFiManagerBase::onYoYoRequestPOST(uint8_t *data, size_t len, AsyncWebServerRequest *request, int route) {
+  //browsers send JSON, peers running this library send MessagePack:
+  bool json = request -> contentType().equals("application/json");
+  bool msgPack = request -> contentType().equals("application/msgpack");
+
+  if((json || msgPack) && !beginRequestArena()) {
+    sendUnavailable(request, 1);
+  }
+  else if(json || msgPack) {
+    YoYoArenaJsonDocument message(config.documentBytes, requestAllocator());
+    YoYoArenaJsonDocument payload(config.documentBytes, requestAllocator());
+
+    //NB cast to (const char*) forces a copy by value as data is freed once the request has been handled:
+    DeserializationError error = json ? deserializeJson(payload, (const char*) data, len) : deserializeMsgPack(payload, (const char*) data, len);
+
+    if(error == DeserializationError::Ok) {
+      message["payload"] = payload;
+      setMessagePath(message.as<JsonVariant>(), route, request->url().c_str());
+      message["method"] = "POST";
+
+      AsyncResponseStream *response = request->beginResponseStream("application/json");
+      sendResponse(request, response, onYoYoMessagePOST(route, message.as<JsonVariant>(), request->client()->remoteIP(), *response));
+    }
+    else request->send(400);
+
+    endRequestArena();
+  }
+  else {
+    YY_LOGW("unknown content type: %s", request -> contentType().c_str());
+    request->send(415);
+  }
+}
+
+//Writes each chunk of an upload to the file system as it arrives - only one upload is accepted at a time
+void YoYoWiFiManagerBase::writeUpload(AsyncWebServerRequest *request, String path, size_t index, uint8_t *data, size_t len, bool final) {
+  if(index == 0 && SPIFFS_ENABLED) {
+    if(!path.startsWith("/")) path = "/" + path;
+
+    if(fileUpload.begin(request, path.c_str())) {
+      YY_LOGI("upload: %s", path.c_str());   //aborted by endRequest() if the connection is lost
+    }
+  }
+
+  if(fileUpload.isOwner(request) && !fileUpload.isComplete()) {
+    fileUpload.write(data, len);
+
+    if(final) {
+      String md5 = request->hasParam("md5") ? request->getParam("md5")->value() : "";
+      if(fileUpload.end(md5.c_str())) fileSystemGeneration++;
+    }
+  }
+}
+
+void YoYoWiFiManagerBase::onYoYoRequestUPLOAD(AsyncWebServerRequest *request) {
+  if(fileUpload.isOwner(request)) {
+    if(fileUpload.isComplete() && !fileUpload.hasFailed()) {
+      AsyncResponseStream *response = request->beginResponseStream("application/json");
+      response->printf("{\"path\":\"%s\",\"bytes\":%u,\"ms\":%u,\"md5\":\"%s\"}", fileUpload.getPath(), (unsigned int) fileUpload.getBytes(), (unsigned int) fileUpload.getDurationMs(), fileUpload.getMD5().c_str());
+      request->send(response);
+    }
+    else {
+      request->send(fileUpload.isCorrupt() ? 400 : 500);
+    }
+    fileUpload.release();
+  }
+  else if(fileUpload.isActive()) {
+    //busy with another upload:
+    sendUnavailable(request, 1);
+  }
+  else {
+    request->send(400); //no file - or an invalid path
+  }
+}
+
+//Prints the JSON response to response and returns 200 - or returns an error code having printed nothing
+int YoYoWiFiManagerBase::onYoYoMessagePOST(int route, JsonVariant message, IPAddress sender, Print &response) {
+  int httpResponseCode = 404;
+  YY_LOGD("onYoYoMessagePOST: %s", message["path"] | "");
+
+  switch(route) {
+    case YY_ROUTE_METHOD_NOT_ALLOWED:
+      httpResponseCode = 405;
+      break;
+    case YY_ROUTE_BATCH:
+      httpResponseCode = onYoYoBatchPOST(message["payload"], sender, response);
+      break;
+    case YY_ROUTE_BROADCAST:
+      //request to broadcast a message to the peer network - 404 unless part of one:
+      httpResponseCode = onYoYoBroadcastPOST(message["payload"], sender);
+      if(httpResponseCode == 200) response.print("{}");
+      break;
+    case YY_ROUTE_UPLOAD:
+      httpResponseCode = 400; //files are uploaded directly, not as part of a message
+      break;
+    case YY_ROUTE_CREDENTIALS:
+      if(settings && message["payload"]["ssid"].is<const char *>() && message["payload"]["password"].is<const char *>()) {
+        //saved and connected to by the next loop():
+        if(pushIntent(YY_INTENT_CREDENTIALS, message["payload"], sender)) {
+          printPendingCredentials(message["payload"], response);
+          message["broadcast"] = true;
+          httpResponseCode = 200;
+        }
+        else httpResponseCode = 503;
+      }
+      else httpResponseCode = 400;
+      break;
+    case YY_ROUTE_FIRMWARE:
+      httpResponseCode = 403;   //firmware only arrives as a broadcast from the peer server
+      break;
+    default:
+      if(applyMessagePOST(route, message)) {
+        response.print("{}");
+        httpResponseCode = 200;
+      }
+      break;
+  }
+
+  if(httpResponseCode == 200 && message["broadcast"] == true) {
+    if(!pushIntent(YY_INTENT_BROADCAST, message, sender)) YY_LOGW("intent queue full - not broadcast");
+  }
+
+  return(httpResponseCode);
+}
+
+//Known paths are interned - the message refers to the route table's path rather than a copy of the URL:
+void YoYoWiFiManagerBase::setMessagePath(JsonVariant message, int route, const char *path) {
+  const char *internedPath = routes.getPath(route);
+
+  if(internedPath) message["path"] = internedPath;
+  else if(message["path"].as<const char *>() != path) message["path"] = (char *) path;
+  message["route"] = route;
+}
+
+int YoYoWiFiManagerBase::getRoute(const char *path, WebRequestMethodComposite method) {
+  return(findRoute(path, method));
+}
+
+//The route for path - unless its feature has been configured out:
+int YoYoWiFiManagerBase::findRoute(const char *path, WebRequestMethodComposite method) {
+  int route = routes.find(path, method);
+
+  switch(route) {
+    case YY_ROUTE_BROADCAST:
+      if(!broadcastQueue.isEnabled()) route = YY_ROUTE_NOT_FOUND;
+      break;
+    case YY_ROUTE_UPLOAD:
+    case YY_ROUTE_FIRMWARE:
+    case YY_ROUTE_MANIFEST:
+    case YY_ROUTE_ASSET:
+      if(!config.fileTransfer) route = YY_ROUTE_NOT_FOUND;
+      break;
+  }
+
+  return(route);
+}
+
+//Applies a POST to the manager's own state - or passes it to the handler of a route added with on(), or to the POST handler passed to init() for any other path.
+//Broadcasts from peers come through here too:
+bool YoYoWiFiManagerBase::applyMessagePOST(int route, JsonVariant message) {
+  bool success = false;
+
+  routeCallbackPtr handler = routes.getHandler(route);
+  if(route == YY_ROUTE_CREDENTIALS) success = saveCredentials(message["payload"]);
+  else if(route == YY_ROUTE_FIRMWARE) success = onFirmwareMessage(message["payload"]);
+  else if(handler)                  success = handler(route, message);
+  else if(yoYoCommandPostHandler)   success = yoYoCommandPostHandler(message);
+
+  return(success);
+}
+
+//Runs each {"method", "path", "payload"} command in turn and prints an array of {"path", "payload", "status"} results
+int YoYoWiFiManagerBase::onYoYoBatchPOST(JsonVariant batch, IPAddress sender, Print &response) {
+  int httpResponseCode = 400;
+
+  if(batch.is<JsonArray>()) {
+    response.print("[");
+
+    int n = 0;
+    for (JsonVariant command : batch.as<JsonArray>()) {
+      const char *path = command["path"] | "";
+      int status = 400;
+
+      if(n++ > 0) response.print(",");
+      response.print("{\"path\":");
+      serializeJson(command["path"], response);
+      response.print(",\"payload\":");
+
+      if(command["method"].isNull() || command["method"] == "GET") {
+        status = onYoYoMessageGET(findRoute(path, HTTP_GET), path, response);
+      }
+      else if(command["method"] == "POST") {
+        int route = findRoute(path, HTTP_POST);
+
+        //batches don't nest:
+        if(route != YY_ROUTE_BATCH) {
+          YoYoArenaJsonDocument message(config.documentBytes, requestAllocator());
+          message["payload"] = command["payload"];
+          setMessagePath(message.as<JsonVariant>(), route, path);
+          message["method"] = "POST";
+
+          status = onYoYoMessagePOST(route, message.as<JsonVariant>(), sender, response);
+        }
+      }
+
+      if(status != 200) response.print("null");
+      response.printf(",\"status\":%d}", status);
+    }
+
+    response.print("]");
+    httpResponseCode = 200;
+  }
+
+  return(httpResponseCode);
+}
+
+//Runs on the request handler's task - the message is checked here, and applied and passed on by loop():
+int YoYoWiFiManagerBase::onYoYoBroadcastPOST(JsonVariant message, IPAddress sender) {
+  int httpResponseCode = 404;
+  YY_LOGD("onYoYoBroadcastPOST: %s", message["path"] | "");
+
+  //message is of the form {"path":"/yoyo/colour", "payload":{...}} - with "origin" and "seq" once stamped by a peer
+  if((currentMode == YY_MODE_PEER_SERVER || currentMode == YY_MODE_PEER_CLIENT) && message["path"].is<const char*>()) {
+    if(findRoute(message["path"], HTTP_POST) == YY_ROUTE_FIRMWARE && !isFirmwareSource(message["payload"], sender)) {
+      //neither applied nor passed on:
+      YY_LOGW("firmware message refused from %s", sender.toString().c_str());
+      httpResponseCode = 403;
+    }
+    else {
+      //the sender tries again later:
+      httpResponseCode = pushIntent(YY_INTENT_RECEIVED, message, sender) ? 200 : 503;
+    }
+  }
+
+  return(httpResponseCode);
+}
+
+void YoYoWiFiManagerBase::receiveBroadcast(JsonVariant message, IPAddress sender) {
+  if(!message.containsKey("method")) message["method"] = "POST";
+
+  //a repeat (a retry or a message that has looped back) has already been applied here:
+  bool duplicate = message.containsKey("origin") && !seenMessages.check(message["origin"], message["seq"]);
+
+  if(!duplicate) {
+    //apply locally before passing it on:
+    if(message["method"] == "POST") {
+      int route = findRoute(message["path"], HTTP_POST);
+      setMessagePath(message, route, message["path"]);
+
+      applyMessagePOST(route, message);
+    }
+
+    addBroadcastMessage(message, sender);
+  }
+}
+
+void YoYoWiFiManagerBase::addBroadcastMessage(JsonVariant message, IPAddress sender) {
+  if(!message.containsKey("origin")) {
+    //the message originates here:
+    message["origin"] = getChipId();
+    message["seq"] = ++broadcastSeq;
+    seenMessages.add(message["origin"], message["seq"]);
+  }
+
+  //a peer client relays to the peer server - unless the message came from it in the first place:
+  bool relay = (currentMode == YY_MODE_PEER_CLIENT && (uint32_t) sender != (uint32_t) WiFi.gatewayIP());
+
+  if(currentMode == YY_MODE_PEER_SERVER || relay) {
+    //only the id, path, method and payload are forwarded - route ids are local to each device:
+    int route = message["route"] | YY_ROUTE_NOT_FOUND;
+    message.remove("broadcast");
+    message.remove("route");
+
+    yy_broadcast_t *broadcast = broadcastQueue.push();
+    if(broadcast) {
+      broadcast -> origin = message["origin"];
+      broadcast -> seq = message["seq"];
+      broadcast -> route = route;
+      broadcast -> sender = sender;
+      broadcast -> queuedAtMs = millis();
+      //serialised once as MessagePack - smaller than JSON and cheaper for peers to parse:
+      broadcast -> length = serializeMsgPack(message, broadcast -> body, YY_BROADCAST_MAX_BYTES);
+
+      if(broadcast -> length == 0 || broadcast -> length >= YY_BROADCAST_MAX_BYTES) {
+        YY_LOGW("broadcast message too long");
+        broadcast -> length = 0;
+      }
+    }
+    else YY_LOGW("broadcast queue full");
+  }
+}
+
+void YoYoWiFiManagerBase::processBroadcastMessageList() {
+  //messages are delivered in order - the next starts once every peer has acknowledged or been given up on:
+  yy_broadcast_t *broadcast = broadcastQueue.front();
+
+  if(broadcast) {
+    if(!broadcast -> started) startBroadcast(broadcast);
+
+    if(broadcastMessage(broadcast)) {
+      metrics.broadcastFanOut.add((millis() - broadcast -> queuedAtMs) * 1000);
+      if(onBroadcastReporthandler) {
+        onBroadcastReporthandler(broadcast);
+      }
+      broadcastQueue.pop();
+    }
+  }
+}
+
+void YoYoWiFiManagerBase::startBroadcast(yy_broadcast_t *broadcast) {
+  broadcast -> peerCount = 0;
+
+  if(broadcast -> length > 0) {
+    if(currentMode == YY_MODE_PEER_SERVER) {
+      //every peer except the sender:
+      IPAddress ipAddress;
+      int peerCount = countPeers();
+      for (int i = 0; i < peerCount && broadcast -> peerCount < broadcastQueue.getMaxPeers(); i++) {
+        getPeerN(i, &ipAddress, NULL);
+        if((uint32_t) ipAddress != (uint32_t) broadcast -> sender) {
+          broadcast -> peers[broadcast -> peerCount++].ip = ipAddress;
+        }
+      }
+    }
+    else if(currentMode == YY_MODE_PEER_CLIENT && currentStatus == YY_CONNECTED_PEER_CLIENT) {
+      //a single call to the peer server, which fans it out to everyone else:
+      broadcast -> peers[broadcast -> peerCount++].ip = WiFi.gatewayIP();
+    }
+  }
+
+  for(int n = 0; n < broadcast -> peerCount; ++n) {
+    yy_peer_delivery_t *peer = &broadcast -> peers[n];
+    peer -> status = YY_DELIVERY_PENDING;
+    peer -> attempts = 0;
+    peer -> responseCode = 0;
+    peer -> nextAttemptAtMs = millis();
+    peer -> deliveredAtMs = 0;
+    peer -> json = false;
+  }
+
+  broadcast -> started = true;
+}
+
+bool YoYoWiFiManagerBase::broadcastMessage(yy_broadcast_t *broadcast) {
+  bool complete = true;
+
+  for(int n = 0; n < broadcast -> peerCount; ++n) {
+    yy_peer_delivery_t *peer = &broadcast -> peers[n];
+
+    if(peer -> status == YY_DELIVERY_PENDING) {
+      if((int32_t)(millis() - peer -> nextAttemptAtMs) >= 0) {
+        peer -> responseCode = postBroadcast(broadcast, peer);
+        peer -> attempts++;
+
+        if(peer -> responseCode >= 200 && peer -> responseCode < 300) {
+          peer -> status = YY_DELIVERY_ACKNOWLEDGED;
+          peer -> deliveredAtMs = millis();
+        }
+        else if(peer -> attempts >= YY_BROADCAST_MAX_ATTEMPTS || !isRetryable(peer -> responseCode)) {
+          peer -> status = YY_DELIVERY_FAILED;
+        }
+        else {
+          //exponential backoff with jitter - so peers that were busy together don't all retry together:
+          uint32_t backoffMs = YY_BROADCAST_RETRY_MIN_MS << (peer -> attempts - 1);
+          peer -> nextAttemptAtMs = millis() + backoffMs + random(backoffMs);
+        }
+      }
+      complete = complete && (peer -> status != YY_DELIVERY_PENDING);
+    }
+  }
+
+  return(complete);
+}
+
+int YoYoWiFiManagerBase::postBroadcast(yy_broadcast_t *broadcast, yy_peer_delivery_t *peer) {
+  int httpResponseCode = -1;
+  String server = peer -> ip.toString();
+
+  //peers receive the whole message (including its id) via their own /yoyo/broadcast endpoint:
+  if(!peer -> json) {
+    httpResponseCode = POST(server.c_str(), "/yoyo/broadcast", (uint8_t *) broadcast -> body, broadcast -> length, "application/msgpack");
+
+    //a peer that doesn't understand MessagePack (earlier versions answer 400) is sent JSON from then on:
+    if(httpResponseCode == 415 || httpResponseCode == 400) peer -> json = true;
+  }
+
+  if(peer -> json) {
+    DynamicJsonDocument message(YY_BROADCAST_MAX_BYTES * 2);
+    if(deserializeMsgPack(message, (const char *) broadcast -> body, broadcast -> length) == DeserializationError::Ok) {
+      httpResponseCode = POST(server.c_str(), "/yoyo/broadcast", message.as<JsonVariant>());
+    }
+  }
+
+  return(httpResponseCode);
+}
+
+bool YoYoWiFiManagerBase::isRetryable(int httpResponseCode) {
+  //connection errors (< 0), server errors and "too many requests" are worth another go - any other refusal is final:
+  return(httpResponseCode < 0 || httpResponseCode >= 500 || httpResponseCode == 429);
+}
+
+void YoYoWiFiManagerBase::setBroadcastReportHandler(broadcastCallbackPtr onBroadcastReporthandler) {
+  this -> onBroadcastReporthandler = onBroadcastReporthandler;
+}
+
+uint32_t YoYoWiFiManagerBase::getDuplicateBroadcastCount() {
+  return(seenMessages.getDuplicateCount());
+}
+
+uint32_t YoYoWiFiManagerBase::getDroppedIntentCount() {
+  return(intents.getDropped());
+}
+
+//Hands a change to the manager's state over to loop() - returns false if the queue is full or the message too long:
+bool YoYoWiFiManagerBase::pushIntent(yy_intent_type_t type, JsonVariant message, IPAddress sender, int route) {
+  bool success = false;
+  uint32_t position;
+  yy_intent_t *intent = intents.reserve(&position);
+
+  if(intent) {
+    intent -> type = type;
+    intent -> route = route;
+    intent -> sender = sender;
+    intent -> length = serializeMsgPack(message, intent -> body, YY_INTENT_MAX_BYTES);
+    if(intent -> length >= YY_INTENT_MAX_BYTES) intent -> length = 0;    //too long - skipped by loop()
+
+    success = (intent -> length > 0);
+    intents.commit(position);   //the cell belongs to loop() from here on
+
+    #if defined(ESP32)
+      if(task) xTaskNotifyGive(task);   //wakes loop() early
+    #endif
+  }
+
+  return(success);
+}
+
+//Applies the intents pushed by request handlers since the last loop() - in order, and no more than the queue holds so a busy handler can't hold up loop():
+void YoYoWiFiManagerBase::processIntents() {
+  yy_intent_t *intent = intents.front();
+
+  if(intent) {
+    DynamicJsonDocument message(YY_INTENT_MAX_BYTES * 2);
+
+    for(int n = 0; n < config.intentQueueDepth && intent; ++n) {
+      if(intent -> length > 0) {
+        if(deserializeMsgPack(message, (const char *) intent -> body, intent -> length) == DeserializationError::Ok) {
+          applyIntent(intent, message.as<JsonVariant>());
+        }
+      }
+
+      intents.pop();
+      intent = intents.front();
+    }
+  }
+}
+
+void YoYoWiFiManagerBase::applyIntent(yy_intent_t *intent, JsonVariant message) {
+  switch(intent -> type) {
+    case YY_INTENT_CREDENTIALS:
+      saveCredentials(message);
+      break;
+    case YY_INTENT_RECEIVED:
+      receiveBroadcast(message, intent -> sender);
+      break;
+    case YY_INTENT_BROADCAST:
+      addBroadcastMessage(message, intent -> sender);
+      break;
+    case YY_INTENT_CONNECT:
+      if(message.containsKey("ssid")) connect(message["ssid"].as<const char *>(), message["password"] | "");
+      else connect();
+      break;
+    case YY_INTENT_END:
+      end();
+      break;
+    case YY_INTENT_DISTRIBUTE_FIRMWARE:
+      if(!distributeFirmware(taskFirmwarePath)) YY_LOGW("can't distribute: %s", taskFirmwarePath ? taskFirmwarePath : "");
+      break;
+    case YY_INTENT_SYNC_ASSETS:
+      if(!syncAssets()) YY_LOGW("can't sync assets");
+      break;
+  }
+}
+
+#if defined(ESP32)
+//Runs loop() in a task of its own - woken every intervalMs, or as soon as an intent is pushed. Call after begin():
+bool YoYoWiFiManagerBase::startTask(uint32_t intervalMs, int core, int priority) {
+  if(!task) {
+    taskIntervalMs = intervalMs;
+    updateSnapshot();
+
+    if(xTaskCreatePinnedToCore(runTask, "YoYoWiFiManager", MANAGER_TASK_STACK_BYTES, this, priority, &task, core) != pdPASS) {
+      task = NULL;
+      YY_LOGE("can't start task");
+    }
+  }
+
+  return(task != NULL);
+}
+
+bool YoYoWiFiManagerBase::isTaskRunning() {
+  return(task != NULL);
+}
+
+void YoYoWiFiManagerBase::runTask(void *manager) {
+  YoYoWiFiManagerBase *self = (YoYoWiFiManagerBase *) manager;
+
+  while(true) {
+    self -> loop();
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(min(self -> taskIntervalMs, self -> scheduler.getMsUntilNext())));
+  }
+}
+
+//True once in task mode - for any task but the manager's own (which includes the web server's):
+bool YoYoWiFiManagerBase::isOtherTask() {
+  return(task != NULL && xTaskGetCurrentTaskHandle() != task);
+}
+
+void YoYoWiFiManagerBase::updateSnapshot() {
+  int peers = countPeers();
+  int clients = countClients();
+
+  portENTER_CRITICAL(&snapshotMux);
+  snapshot.status = currentStatus;
+  snapshot.peers = peers;
+  snapshot.clients = clients;
+  portEXIT_CRITICAL(&snapshotMux);
+}
+#endif
+
+void YoYoWiFiManagerBase::onYoYoRequestDELETE(uint8_t *data, size_t len, AsyncWebServerRequest *request) {
+  //TODO fix this!
+
+  //TODO: this limit seems artificial
+  // char *json = new char[1024];
   // len = min(len, (unsigned int) 1024-1);
   // int i = 0;
   // for (; i < len; i++)  json[i] = char(data[i]);
@@ -817,9 +2039,9 @@ void YoYoWiFiManager::onYoYoRequestDELETE(uint8_t *data, size_t len, AsyncWebSer
   // delete json;
 }
 
-void YoYoWiFiManager::onYoYoMessageDELETE(JsonVariant message, AsyncWebServerRequest *request) {
+void YoYoWiFiManagerBase::onYoYoMessageDELETE(JsonVariant message, AsyncWebServerRequest *request) {
   bool success = false;
-  Serial.println("onYoYoMessageDELETE: " + message["path"].as<String>());
+  YY_LOGD("onYoYoMessageDELETE: %s", message["path"] | "");
 
   if (message["path"] == "/yoyo/credentials") {
     //TODO: implement delete using YoYoSettings::removeNetwork()
@@ -829,13 +2051,13 @@ void YoYoWiFiManager::onYoYoMessageDELETE(JsonVariant message, AsyncWebServerReq
   request->send(success ? 200 : 404);
 }
 
-int YoYoWiFiManager::POST(const char *server, const char *path, JsonVariant payload, char *response) {
+int YoYoWiFiManagerBase::POST(const char *server, const char *path, JsonVariant payload, char *response, size_t responseSize) {
   int httpResponseCode = -1;
 
   String jsonAsString;
   jsonAsString.reserve(payload.memoryUsage());
   if(serializeJson(payload, jsonAsString) > 0) {
-    httpResponseCode = POST(server, path, jsonAsString.c_str(), "application/json", response);
+    httpResponseCode = POST(server, path, jsonAsString.c_str(), "application/json", response, responseSize);
     if(response) {
       //TODO: parse json
     }
@@ -844,84 +2066,197 @@ int YoYoWiFiManager::POST(const char *server, const char *path, JsonVariant payl
   return(httpResponseCode);
 }
 
-int YoYoWiFiManager::POST(const char *server, const char *path, const char *payload, char *contentType, char *response) {
+int YoYoWiFiManagerBase::POST(const char *server, const char *path, const char *payload, char *contentType, char *response, size_t responseSize) {
+  YY_LOGD("POST http://%s%s", server, path);
+
+  return(POST(server, path, (uint8_t *) payload, strlen(payload), contentType, response, responseSize));
+}
+
+int YoYoWiFiManagerBase::POST(const char *server, const char *path, uint8_t *payload, size_t length, char *contentType, char *response, size_t responseSize) {
   int httpResponseCode = -1;
 
-  String urlAsString = "http://" + String(server) + String(path);
-  Serial.printf("POST %s > %s\n", urlAsString.c_str(), payload);
+  HTTPClient *http = httpClientPool.acquire(server, path);
+  if(http) {
+    if(contentType) http -> addHeader("Content-Type", contentType);
 
-  HTTPClient http;
-  WiFiClient client;
-  http.begin(client, urlAsString);
-  if(contentType) http.addHeader("Content-Type", contentType);
+    httpResponseCode = http -> POST(payload, length);
 
-  httpResponseCode = http.POST(payload);
+    bool keepAlive = false;
+    if(httpResponseCode > 0) {
+      keepAlive = httpClientPool.drain(http, readResponse(http, response, responseSize));
+    }
 
-  if(response && httpResponseCode > 0) {
-    //#TODO: test length?
-    strcpy(response, http.getString().c_str());
+    httpClientPool.release(http, keepAlive);
   }
 
-  client.stop();
-  http.end();
+  return(httpResponseCode);
+}
+
+int YoYoWiFiManagerBase::GET(const char *server, const char *path, JsonDocument &response) {
+  int httpResponseCode = -1;
+
+  YY_LOGD("GET http://%s%s", server, path);
+
+  HTTPClient *http = httpClientPool.acquire(server, path);
+  if(http) {
+    httpResponseCode = http -> GET();
+
+    bool keepAlive = false;
+    if (httpResponseCode > 0) {
+      YoYoCountingStream stream(http -> getStream());
+
+      if(deserializeJson(response, stream) != DeserializationError::Ok) {
+        httpResponseCode = -1;
+      }
+      else keepAlive = httpClientPool.drain(http, stream.getCount());
+    }
+    httpClientPool.release(http, keepAlive);
+  }
 
   return(httpResponseCode);
 }
 
-int YoYoWiFiManager::GET(const char *server, const char *path, JsonDocument &response) {
+int YoYoWiFiManagerBase::GET(const char *server, const char *path, JsonDocument &filter, jsonVisitorPtr visitor, void *context) {
   int httpResponseCode = -1;
 
-  String urlAsString = "http://" + String(server) + String(path);
-  Serial.printf("GET %s\n", urlAsString.c_str());
+  YY_LOGD("GET http://%s%s", server, path);
 
-  HTTPClient http;
-  WiFiClient client;
-  http.begin(client, urlAsString);
+  HTTPClient *http = httpClientPool.acquire(server, path);
+  if(http) {
+    httpResponseCode = http -> GET();
 
-  httpResponseCode = http.GET();
-  if (httpResponseCode > 0) {
-    if(deserializeJson(response, http.getStream()) != DeserializationError::Ok) {
-      httpResponseCode = -1;
+    bool keepAlive = false;
+    if (httpResponseCode > 0) {
+      //parse the array one element at a time into a small fixed document, however long it is:
+      YoYoCountingStream stream(http -> getStream());
+      StaticJsonDocument<GET_ELEMENT_MAX_BYTES> element;
+
+      if(stream.find("[")) {
+        do {
+          if(deserializeJson(element, stream, DeserializationOption::Filter(filter)) != DeserializationError::Ok) break;
+          if(!visitor(element.as<JsonVariant>(), context)) break;
+        } while(stream.findUntil(",", "]"));
+      }
+      //the visitor may have stopped early:
+      keepAlive = httpClientPool.drain(http, stream.getCount());
     }
+    httpClientPool.release(http, keepAlive);
   }
-  client.stop();
-  http.end();
 
   return(httpResponseCode);
 }
 
-int YoYoWiFiManager::GET(const char *server, const char *path, char *response) {
+int YoYoWiFiManagerBase::GET(const char *server, const char *path, char *response, size_t responseSize) {
   int httpResponseCode = -1;
 
-  String urlAsString = "http://" + String(server) + String(path);
-  Serial.printf("GET %s\n", urlAsString.c_str());
+  YY_LOGD("GET http://%s%s", server, path);
 
-  HTTPClient http;
-  WiFiClient client;
-  http.begin(client, urlAsString);
+  HTTPClient *http = httpClientPool.acquire(server, path);
+  if(http) {
+    httpResponseCode = http -> GET();
 
-  httpResponseCode = http.GET();
-  if (httpResponseCode > 0) {
-    //#TODO: test length?
-    strcpy(response, http.getString().c_str());
+    bool keepAlive = false;
+    if (httpResponseCode > 0) {
+      keepAlive = httpClientPool.drain(http, readResponse(http, response, responseSize));
+    }
+    httpClientPool.release(http, keepAlive);
   }
-  client.stop();
-  http.end();
 
   return(httpResponseCode);
 }
 
-void YoYoWiFiManager::getCredentials(AsyncWebServerRequest *request) {
-  AsyncResponseStream *response = request->beginResponseStream("application/json");
+//Returns the number of bytes read - what's left over is drained (or the connection closed) by the caller:
+size_t YoYoWiFiManagerBase::readResponse(HTTPClient *http, char *response, size_t responseSize) {
+  size_t length = 0;
 
-  response->print(getCredentialsAsJsonString());
-  request->send(response);
+  if(response && responseSize > 0) {
+    //never more than the buffer can hold:
+    size_t maxLength = responseSize - 1;
+    int contentLength = http -> getSize();
+    if(contentLength >= 0 && (size_t) contentLength < maxLength) maxLength = contentLength;
+
+    length = http -> getStream().readBytes(response, maxLength);
+    response[length] = '\0';
+  }
+
+  return(length);
 }
 
-String YoYoWiFiManager::getCredentialsAsJsonString() {
+//Prints the response for a built-in GET route - the cached copy unless what it was made from has changed
+void YoYoWiFiManagerBase::printResponse(int route, Print &response) {
+  uint32_t generation;
+  String *cached = NULL;
+
+  if(responseCache.isEnabled() && getResponseGeneration(route, &generation)) {
+    cached = responseCache.get(route, generation);
+    if(!cached) cached = responseCache.put(route, generation, getResponseAsJsonString(route));
+  }
+
+  if(cached) response.print(*cached);
+  else response.print(getResponseAsJsonString(route));
+}
+
+//The generation of the data a route's response is made from - returns false if the response can't be cached
+bool YoYoWiFiManagerBase::getResponseGeneration(int route, uint32_t *generation) {
+  bool success = false;
+
+  switch(route) {
+    case YY_ROUTE_CREDENTIALS:
+      //both only ever move on - so neither a write from here nor a change() from the settings themselves is missed:
+      *generation = settingsGeneration + (settings ? settings -> getGeneration() : 0);
+      success = true;
+      break;
+    case YY_ROUTE_NETWORKS:
+      scan.request();   //keeps the scan results up to date
+      *generation = scan.getGeneration();
+      success = true;
+      break;
+    case YY_ROUTE_CLIENTS:
+    case YY_ROUTE_PEERS:
+      //only the peer server's lists are made from the station list - a peer client's come from the gateway:
+      if(currentMode == YY_MODE_PEER_SERVER) {
+        *generation = stationGeneration;
+        success = true;
+      }
+      break;
+  }
+
+  return(success);
+}
+
+String YoYoWiFiManagerBase::getResponseAsJsonString(int route) {
   String jsonString;
 
-  DynamicJsonDocument jsonDoc(1024);
+  switch(route) {
+    case YY_ROUTE_NETWORKS:
+      jsonString = getNetworksAsJsonString();
+      break;
+    case YY_ROUTE_CLIENTS:
+      jsonString = getClientsAsJsonString();
+      break;
+    case YY_ROUTE_PEERS:
+      jsonString = getPeersAsJsonString();
+      break;
+    case YY_ROUTE_CREDENTIALS:
+      jsonString = getCredentialsAsJsonString();
+      break;
+  }
+
+  return(jsonString);
+}
+
+uint32_t YoYoWiFiManagerBase::getResponseCacheHits() {
+  return(responseCache.getHits());
+}
+
+uint32_t YoYoWiFiManagerBase::getResponseCacheMisses() {
+  return(responseCache.getMisses());
+}
+
+String YoYoWiFiManagerBase::getCredentialsAsJsonString() {
+  String jsonString;
+
+  YoYoArenaJsonDocument jsonDoc(config.documentBytes, requestAllocator());
   getCredentialsAsJson(jsonDoc);
 
   if(!jsonDoc.isNull()) {
@@ -932,13 +2267,13 @@ String YoYoWiFiManager::getCredentialsAsJsonString() {
   return (jsonString);
 }
 
-void YoYoWiFiManager::getCredentialsAsJson(JsonDocument& jsonDoc) {
+void YoYoWiFiManagerBase::getCredentialsAsJson(JsonDocument& jsonDoc) {
   //TODO: should in same structure - just missing the password field or replacing with *s
  
   if(settings) {
     //Get all the credentials and turn them into json - but not passwords
-    char *ssid = new char[SSID_MAX_LENGTH];
-    char *password = new char[PASSWORD_MAX_LENGTH];
+    char ssid[SSID_MAX_LENGTH];
+    char password[PASSWORD_MAX_LENGTH];
 
     int credentialsCount = settings -> getNumberOfNetworkCredentials();
     int lastNetwork = settings -> getLastNetwork();
@@ -955,57 +2290,63 @@ void YoYoWiFiManager::getCredentialsAsJson(JsonDocument& jsonDoc) {
       network["password"] = password;
       if(n == lastNetwork) network["lastnetwork"] = true;
     }
-    delete ssid, password;
   }
 }
 
-bool YoYoWiFiManager::setCredentials(JsonVariant json, AsyncWebServerRequest *request) {
-  serializeJson(json, Serial);
+//The saved networks as they will be once the next loop() has saved pending - as a POST to /yoyo/credentials has always answered:
+void YoYoWiFiManagerBase::printPendingCredentials(JsonVariant pending, Print &response) {
+  YoYoArenaJsonDocument jsonDoc(config.documentBytes, requestAllocator());
+  getCredentialsAsJson(jsonDoc);
 
-  bool success = setCredentials(json);
-  if(success) {
-    request->send(200, "application/javascript", getCredentialsAsJsonString());
-  }
-  else {
-    request->send(400);
+  const char *ssid = pending["ssid"];
+  JsonObject network;
+
+  for(JsonObject saved : jsonDoc.as<JsonArray>()) {
+    if(saved["ssid"] == ssid) network = saved;
   }
+  if(network.isNull()) network = jsonDoc.createNestedObject();
 
-  return(success);
+  char password[PASSWORD_MAX_LENGTH];
+  size_t length = min(strlen(pending["password"]), (size_t) PASSWORD_MAX_LENGTH - 1);
+  memset(password, '*', length);
+  password[length] = '\0';
+
+  network["ssid"] = ssid;
+  network["password"] = password;
+
+  serializeJson(jsonDoc, response);
 }
 
-bool YoYoWiFiManager::setCredentials(JsonVariant json) {
+bool YoYoWiFiManagerBase::setCredentials(JsonVariant json) {
   bool success = false;
 
   if(settings) {
-    char *ssid = new char[SSID_MAX_LENGTH];
-    char *password = new char[PASSWORD_MAX_LENGTH];
-
-    strcpy(ssid, json["ssid"]);
-    strcpy(password, json["password"]);
+    const char *ssid = json["ssid"];
+    const char *password = json["password"];
 
     if(ssid && password) {
-      Serial.printf("setCredentials %s  %s\n", ssid, password);
+      YY_LOGD("setCredentials %s", ssid);
       success = addNetwork(ssid, password, true);
     }
-
-    delete password;
-    delete ssid;
   }
 
   return(success);
 }
 
-void YoYoWiFiManager::getPeers(AsyncWebServerRequest * request) {
-  AsyncResponseStream *response = request->beginResponseStream("application/json");
+//Saves the network and connects to it - from a POST here or a peer's broadcast:
+bool YoYoWiFiManagerBase::saveCredentials(JsonVariant json) {
+  bool success = setCredentials(json);
 
-  response->print(getPeersAsJsonString());
-  request->send(response);
+  if(success) connect();  //this requests YY_MODE_CLIENT mode - which will be accessed on next loop() call
+  else YY_LOGW("can't add network: %s", json["ssid"] | "");
+
+  return(success);
 }
 
-String YoYoWiFiManager::getPeersAsJsonString() {
+String YoYoWiFiManagerBase::getPeersAsJsonString() {
   String jsonString;
 
-  DynamicJsonDocument jsonDoc(1024);
+  YoYoArenaJsonDocument jsonDoc(config.documentBytes, requestAllocator());
   getPeersAsJson(jsonDoc);
   
   if(!jsonDoc.isNull()) {
@@ -1016,50 +2357,59 @@ String YoYoWiFiManager::getPeersAsJsonString() {
   return (jsonString);
 }
 
-void YoYoWiFiManager::getPeersAsJson(JsonDocument& jsonDoc) {
-  IPAddress *ipAddress = new IPAddress();
-  uint8_t *macAddress = new uint8_t[6];
+typedef struct {
+  JsonDocument *jsonDoc;
+  String localIPAddress;
+} peer_list_t;
+
+void YoYoWiFiManagerBase::getPeersAsJson(JsonDocument& jsonDoc) {
+  IPAddress ipAddress;
+  uint8_t macAddress[6];
 
-  IPAddress *localIPAddress = NULL;
+  IPAddress localIPAddress;
   
   if(currentMode == YY_MODE_PEER_SERVER) {
-    localIPAddress = new IPAddress(WiFi.softAPIP());
-    createNestedPeer(jsonDoc, localIPAddress, WiFi.softAPmacAddress(macAddress), true, true);
+    localIPAddress = WiFi.softAPIP();
+    createNestedPeer(jsonDoc, &localIPAddress, WiFi.softAPmacAddress(macAddress), true, true);
 
     int peerCount = countPeers();
     for (int i = 0; i < peerCount; i++) {
-      getPeerN(i, ipAddress, macAddress);
-      createNestedPeer(jsonDoc, ipAddress, macAddress);
+      getPeerN(i, &ipAddress, macAddress);
+      createNestedPeer(jsonDoc, &ipAddress, macAddress);
     }
   }
   else if(currentMode == YY_MODE_PEER_CLIENT) {
-    localIPAddress = new IPAddress(WiFi.localIP());
-    GET(WiFi.gatewayIP().toString().c_str(), "/yoyo/peers", jsonDoc);
-
-    //Correct the LOCALHOST attribution
-    JsonArray peers = jsonDoc.as<JsonArray>();
-    for (JsonVariant peer : peers) {
-        if(peer["LOCALHOST"] == true) {
-          peer.remove("LOCALHOST");
-        }
-        else if(peer["IP"] == localIPAddress->toString()) {
-          peer["LOCALHOST"] = true;
-        }
-    }
+    localIPAddress = WiFi.localIP();
+
+    //Stream the gateway's list one peer at a time - keeping only the fields needed:
+    StaticJsonDocument<64> filter;
+    filter["IP"] = true;
+    filter["MAC"] = true;
+    filter["GATEWAY"] = true;
+
+    peer_list_t peerList = { &jsonDoc, localIPAddress.toString() };
+    GET(WiFi.gatewayIP().toString().c_str(), "/yoyo/peers", filter, addPeerFromGateway, &peerList);
   }
   else if(currentMode == YY_MODE_CLIENT) {
     //The only peer we know about is the local one:
-    localIPAddress = new IPAddress(WiFi.localIP());
-    createNestedPeer(jsonDoc, localIPAddress, WiFi.softAPmacAddress(macAddress), true);
+    localIPAddress = WiFi.localIP();
+    createNestedPeer(jsonDoc, &localIPAddress, WiFi.softAPmacAddress(macAddress), true);
   }
+}
+
+bool YoYoWiFiManagerBase::addPeerFromGateway(JsonVariant peer, void *context) {
+  peer_list_t *peerList = (peer_list_t *) context;
+
+  JsonVariant copy = peerList -> jsonDoc -> addElement();
+  copy.set(peer);
 
-  if(localIPAddress) delete localIPAddress;
+  //Correct the LOCALHOST attribution - the gateway's list is from its point of view:
+  if(peer["IP"] == peerList -> localIPAddress) copy["LOCALHOST"] = true;
 
-  delete ipAddress;
-  delete macAddress;
+  return(!peerList -> jsonDoc -> overflowed());
 }
 
-bool YoYoWiFiManager::getPeerN(int n, IPAddress *ipAddress, uint8_t *macAddress) {
+bool YoYoWiFiManagerBase::getPeerN(int n, IPAddress *ipAddress, uint8_t *macAddress) {
   bool success = false;
 
   switch(currentMode) {
@@ -1091,28 +2441,38 @@ bool YoYoWiFiManager::getPeerN(int n, IPAddress *ipAddress, uint8_t *macAddress)
   return(success);
 }
 
-void YoYoWiFiManager::createNestedPeer(JsonDocument& jsonDoc, IPAddress *ip, uint8_t *macAddress, bool localhost, bool gateway) {
+void YoYoWiFiManagerBase::createNestedPeer(JsonDocument& jsonDoc, IPAddress *ip, uint8_t *macAddress, bool localhost, bool gateway) {
     JsonObject peer = jsonDoc.createNestedObject();
     if(ip && macAddress) {
-      peer["IP"] = ip -> toString();
+      char ipAddressAsCStr[16];
+      ip_addr_to_c_str(*ip, ipAddressAsCStr);
+      peer["IP"] = ipAddressAsCStr;
 
-      char *macAddressAsCStr = new char[18];
+      char macAddressAsCStr[18];
       mac_addr_to_c_str(macAddress, macAddressAsCStr);
       peer["MAC"] = macAddressAsCStr;
-      delete macAddressAsCStr;
 
       if(localhost) peer["LOCALHOST"] = true;
       if(gateway)   peer["GATEWAY"] = true;
     }
 }
 
-bool YoYoWiFiManager::hasPeers() {
+bool YoYoWiFiManagerBase::hasPeers() {
   return(countPeers() > 0);
 }
 
-int YoYoWiFiManager::countPeers() {
+int YoYoWiFiManagerBase::countPeers() {
   int count = 0;
 
+  #if defined(ESP32)
+    if(isOtherTask()) {
+      portENTER_CRITICAL(&snapshotMux);
+      count = snapshot.peers;
+      portEXIT_CRITICAL(&snapshotMux);
+      return(count);
+    }
+  #endif
+
   switch(currentMode) {
     case YY_MODE_NONE:
       break;
@@ -1135,33 +2495,24 @@ int YoYoWiFiManager::countPeers() {
   return(count);
 }
 
-void YoYoWiFiManager::getClients(AsyncWebServerRequest * request) {
-  AsyncResponseStream *response = request->beginResponseStream("application/json");
-
-  response->print(getClientsAsJsonString());
-  request->send(response);
-}
-
-String YoYoWiFiManager::getClientsAsJsonString() {
+String YoYoWiFiManagerBase::getClientsAsJsonString() {
   String jsonString;
 
-  DynamicJsonDocument jsonDoc(1024);
+  YoYoArenaJsonDocument jsonDoc(config.documentBytes, requestAllocator());
   getClientsAsJson(jsonDoc);
   serializeJson(jsonDoc[0], jsonString);
 
   return (jsonString);
 }
 
-void YoYoWiFiManager::getClientsAsJson(JsonDocument& jsonDoc) {
+void YoYoWiFiManagerBase::getClientsAsJson(JsonDocument& jsonDoc) {
   JsonArray clients = jsonDoc.createNestedArray();
 
   if(currentMode == YY_MODE_PEER_SERVER) {
-    char *ipAddress = new char[17];
-    char *macAddress = new char[18];
-    tcpip_adapter_sta_info_t station;
+    char ipAddress[16];
+    char macAddress[18];
 
-    int clientCount = updateClientList();
-    for(int n = 0; n < clientCount; ++n) {
+    for(int n = 0; n < currentClientCount; ++n) {
       strcpy(ipAddress, ip4addr_ntoa(&(adapter_sta_list.sta[n].ip)));
       mac_addr_to_c_str(adapter_sta_list.sta[n].mac, macAddress);
 
@@ -1169,9 +2520,6 @@ void YoYoWiFiManager::getClientsAsJson(JsonDocument& jsonDoc) {
       client["IP"] = ipAddress;
       client["MAC"] = macAddress; 
     }
-
-    delete ipAddress;
-    delete macAddress;
   }
   else if(currentMode == YY_MODE_PEER_CLIENT) {
     //Empty
@@ -1181,123 +2529,109 @@ void YoYoWiFiManager::getClientsAsJson(JsonDocument& jsonDoc) {
   }
 }
 
-int YoYoWiFiManager::updateClientList() {
+//Scheduled every MIN_CLIENTLISTUPDATEINTERVAL:
+int YoYoWiFiManagerBase::updateClientList() {
   int count = 0;
 
-  if(millis() > lastUpdatedClientListAtMs + MIN_CLIENTLISTUPDATEINTERVAL) {
-    if(currentMode == YY_MODE_PEER_SERVER) {
-      #if defined(ESP8266)
-        struct station_info *stat_info;
+  tcpip_adapter_sta_list_t previous = adapter_sta_list;
 
-        count = min(wifi_softap_get_station_num(), (uint8) ESP_WIFI_MAX_CONN_NUM);
-        stat_info = wifi_softap_get_station_info();
+  if(currentMode == YY_MODE_PEER_SERVER) {
+    #if defined(ESP8266)
+      struct station_info *stat_info;
 
-        adapter_sta_list.num = count;
+      count = min(wifi_softap_get_station_num(), (uint8) ESP_WIFI_MAX_CONN_NUM);
+      stat_info = wifi_softap_get_station_info();
 
-        int n=0;
-        tcpip_adapter_sta_info_t station;
-        while (count > 0 && stat_info != NULL) {
-          memcpy(adapter_sta_list.sta[n].mac, stat_info->bssid, sizeof(stat_info->bssid[0])*6);
-          adapter_sta_list.sta[n].ip = stat_info->ip;
+      adapter_sta_list.num = count;
 
-          stat_info = STAILQ_NEXT(stat_info, next);
-          n++;
-        }
-        wifi_softap_free_station_info();
+      int n=0;
+      tcpip_adapter_sta_info_t station;
+      while (count > 0 && stat_info != NULL) {
+        memcpy(adapter_sta_list.sta[n].mac, stat_info->bssid, sizeof(stat_info->bssid[0])*6);
+        adapter_sta_list.sta[n].ip = stat_info->ip;
 
-      #elif defined(ESP32)
-        esp_wifi_ap_get_sta_list(&wifi_sta_list);
-        tcpip_adapter_get_sta_list(&wifi_sta_list, &adapter_sta_list);
-        count = adapter_sta_list.num;
-      #endif
-    }
-    else if(currentMode == YY_MODE_PEER_CLIENT) {
-      //NOTHING TO DO
-    }
-    else if(currentMode == YY_MODE_CLIENT) {
-      //NOTHING TO DO
-    }
-    currentClientCount = count;
-    lastUpdatedClientListAtMs = millis();
+        stat_info = STAILQ_NEXT(stat_info, next);
+        n++;
+      }
+      wifi_softap_free_station_info();
+
+    #elif defined(ESP32)
+      esp_wifi_ap_get_sta_list(&wifi_sta_list);
+      tcpip_adapter_get_sta_list(&wifi_sta_list, &adapter_sta_list);
+      count = adapter_sta_list.num;
+    #endif
   }
-  else {
-    count = currentClientCount;
+  else if(currentMode == YY_MODE_PEER_CLIENT) {
+    //NOTHING TO DO
+  }
+  else if(currentMode == YY_MODE_CLIENT) {
+    //NOTHING TO DO
   }
+  if(count != currentClientCount || memcmp(&previous, &adapter_sta_list, sizeof(adapter_sta_list)) != 0) stationGeneration++;
+
+  currentClientCount = count;
 
   return(count);
 }
 
-bool YoYoWiFiManager::hasClients() {
+bool YoYoWiFiManagerBase::hasClients() {
   return(countClients() > 0);
 }
 
-int YoYoWiFiManager::countClients() {
+int YoYoWiFiManagerBase::countClients() {
   int count = 0;
 
+  #if defined(ESP32)
+    if(isOtherTask()) {
+      portENTER_CRITICAL(&snapshotMux);
+      count = snapshot.clients;
+      portEXIT_CRITICAL(&snapshotMux);
+      return(count);
+    }
+  #endif
+
   if(currentMode == YY_MODE_PEER_SERVER) {
-    count = updateClientList();
+    count = currentClientCount;   //kept up to date by the scheduler
   }
 
   return(count);
 }
 
-void YoYoWiFiManager::getNetworks(AsyncWebServerRequest * request) {
-    AsyncResponseStream *response = request->beginResponseStream("application/json");
-
-    response->print(getNetworksAsJsonString());
-    request->send(response);
-}
-
-String YoYoWiFiManager::getNetworksAsJsonString() {
+String YoYoWiFiManagerBase::getNetworksAsJsonString() {
   String jsonString;
 
-  DynamicJsonDocument jsonDoc(1024);
+  YoYoArenaJsonDocument jsonDoc(config.documentBytes, requestAllocator());
   getNetworksAsJson(jsonDoc);
   serializeJson(jsonDoc[0], jsonString);
 
   return (jsonString);
 }
 
-void YoYoWiFiManager::getNetworksAsJson(JsonDocument& jsonDoc) {
+void YoYoWiFiManagerBase::getNetworksAsJson(JsonDocument& jsonDoc) {
   JsonArray networks = jsonDoc.createNestedArray();
 
-  int n = scanNetworks();
+  yy_network_t result;
+  char bssid[18];
+  uint32_t generation = scan.getGeneration();
+
+  for (int i = 0; scan.get(i, &result, generation); ++i) {
+    if (strlen(result.ssid) < SSID_MAX_LENGTH) {
+      sprintf(bssid, "%02X:%02X:%02X:%02X:%02X:%02X", result.bssid[0], result.bssid[1], result.bssid[2], result.bssid[3], result.bssid[4], result.bssid[5]);
 
-  for (int i = 0; i < n; ++i) {
-    String networkSSID = WiFi.SSID(i);
-    if (networkSSID.length() < SSID_MAX_LENGTH) {
       JsonObject network  = networks.createNestedObject();
-      network["SSID"] = WiFi.SSID(i);
-      network["BSSID"] = WiFi.BSSIDstr(i);
-      network["RSSI"] = WiFi.RSSI(i);
+      network["SSID"] = result.ssid;
+      network["BSSID"] = bssid;
+      network["RSSI"] = result.rssi;
     }
   }
 }
 
-int YoYoWiFiManager::scanNetworks() {
-  int count = 0;
-
-  if(lastScanNetworksAtMs == 0 || millis() > (lastScanNetworksAtMs + SCAN_NETWORKS_MIN_INT)) {
-    lastScanNetworksAtMs = millis();
-
-    #if defined(ESP8266)
-      //ESP8266 scanNetworks() can only operate as async because of ESPAsyncWebServer > https://github.com/me-no-dev/ESPAsyncWebServer#scanning-for-available-wifi-networks
-      //the consequence is that calls to function will fail to return any results if they initiate a scan
-      count = WiFi.scanNetworks(true, false);
-
-    #elif defined(ESP32)
-      count = WiFi.scanNetworks(false, false);
-
-    #endif
-  }
-  else {
-    count = WiFi.scanComplete();
-  }
-
-  return(count);
+//The one place a scan is started or collected - see YoYoScan:
+void YoYoWiFiManagerBase::updateScan() {
+  if(scan.update(SCAN_NETWORKS_MIN_INT)) metrics.scan.add(scan.getDurationMs() * 1000);
 }
 
-bool YoYoWiFiManager::isEspressif(uint8_t *macAddress) {
+bool YoYoWiFiManagerBase::isEspressif(uint8_t *macAddress) {
   bool result = false;
 
   int oui = getOUI(macAddress[0], macAddress[1], macAddress[2]);
@@ -1310,7 +2644,31 @@ bool YoYoWiFiManager::isEspressif(uint8_t *macAddress) {
   return(result);
 }
 
-bool YoYoWiFiManager::mac_addr_to_c_str(uint8_t *mac, char *str) {
+bool YoYoWiFiManagerBase::ip_addr_to_c_str(IPAddress ip, char *str) {
+  bool success = true;
+
+  sprintf(str, "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+
+  return(success);
+}
+
+//The SSID of the network connected to - read without making a String of it:
+char *YoYoWiFiManagerBase::getConnectedSSID(char *ssid) {
+  #if defined(ESP8266)
+    struct station_config config;
+    wifi_station_get_config(&config);
+    strncpy(ssid, (const char *) config.ssid, SSID_MAX_LENGTH - 1);
+  #elif defined(ESP32)
+    wifi_config_t config;
+    esp_wifi_get_config(WIFI_IF_STA, &config);
+    strncpy(ssid, (const char *) config.sta.ssid, SSID_MAX_LENGTH - 1);
+  #endif
+  ssid[SSID_MAX_LENGTH - 1] = '\0';
+
+  return(ssid);
+}
+
+bool YoYoWiFiManagerBase::mac_addr_to_c_str(uint8_t *mac, char *str) {
   bool success = true;
 
   sprintf(str, "%02X:%02X:%02X:%02X:%02X:%02X\0", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
@@ -1318,7 +2676,7 @@ bool YoYoWiFiManager::mac_addr_to_c_str(uint8_t *mac, char *str) {
   return(success);
 }
 
-int YoYoWiFiManager::getOUI(char *mac) {
+int YoYoWiFiManagerBase::getOUI(char *mac) {
   int oui = 0;
 
   //basic format test ##:##:##:##:##:##
@@ -1332,13 +2690,13 @@ int YoYoWiFiManager::getOUI(char *mac) {
   return(oui);
 }
 
-int YoYoWiFiManager::getOUI(uint8_t *mac) {
+int YoYoWiFiManagerBase::getOUI(uint8_t *mac) {
   int oui = getOUI(mac[0], mac[1], mac[2]);
 
   return(oui);
 }
 
-int YoYoWiFiManager::getOUI(uint8_t a, uint8_t b, uint8_t c, uint8_t d, uint8_t e, uint8_t f) {
+int YoYoWiFiManagerBase::getOUI(uint8_t a, uint8_t b, uint8_t c, uint8_t d, uint8_t e, uint8_t f) {
   int oui = (a << 16) & 0xff0000 | (b << 8) & 0x00ff00 | c & 0x0000ff;
 
   return(oui);
@@ -10,6 +10,7 @@
   #include <ESP8266WiFiMulti.h>
   #include <ESPAsyncTCP.h>      //not currently available via Library Manager > https://github.com/me-no-dev/ESPAsyncTCP
   #include <ESP8266HTTPClient.h>
+  #include <ESP8266httpUpdate.h>
   #include <FS.h>
   #include "YoYoWiFiManager/wifi_sta.h"
 
@@ -22,9 +23,28 @@
   #include <SPIFFS.h>
 #endif
 #include <ESPAsyncWebServer.h>
+#include <StreamString.h>
 
 #include "YoYoWiFiManager/YoYoNetworkSettingsInterface.h"
+#include "YoYoWiFiManager/YoYoConfig.h"
+#include "YoYoWiFiManager/YoYoLog.h"
 #include "YoYoWiFiManager/Levenshtein.h"
+#include "YoYoWiFiManager/YoYoSeenMessages.h"
+#include "YoYoWiFiManager/YoYoBroadcastQueue.h"
+#include "YoYoWiFiManager/YoYoIntentQueue.h"
+#include "YoYoWiFiManager/YoYoHTTPClientPool.h"
+#include "YoYoWiFiManager/YoYoRoutes.h"
+#include "YoYoWiFiManager/YoYoFileUpload.h"
+#include "YoYoWiFiManager/YoYoFirmwareUpdate.h"
+#include "YoYoWiFiManager/YoYoAssetSync.h"
+#include "YoYoWiFiManager/YoYoTemplateFile.h"
+#include "YoYoWiFiManager/YoYoManifest.h"
+#include "YoYoWiFiManager/YoYoScan.h"
+#include "YoYoWiFiManager/YoYoResponseCache.h"
+#include "YoYoWiFiManager/YoYoJsonArena.h"
+#include "YoYoWiFiManager/YoYoAdmission.h"
+#include "YoYoWiFiManager/YoYoScheduler.h"
+#include "YoYoWiFiManager/YoYoMetrics.h"
 #include "YoYoWiFiManager/Espressif.h"
 #include "YoYoWiFiManager/index_html.h"
 
@@ -47,6 +67,20 @@
 #define SCAN_NETWORKS_MIN_INT 30000
 #define MIN_CLIENTLISTUPDATEINTERVAL 3000
 #define MIN_MULTIUPDATEINTERVAL 500
+#define HTTP_CLIENT_EVICT_INTERVAL 1000
+#define WIFI_LED_INTERVAL 250
+#define PEER_ELECTION_INTERVAL 5000
+#define PEER_ELECTION_POLL 250            //while a scan is running
+#define PEER_ELECTION_MAX_INTERVAL 300000 //doubled up to this while no other peer server is in sight - each scan takes the radio off the AP's channel
+#define GET_ELEMENT_MAX_BYTES 256
+#define TEMPLATE_VARIABLES_MAX 8
+
+#if defined(ESP32)
+  #define MANAGER_TASK_STACK_BYTES 8192
+  #define MANAGER_TASK_PRIORITY 1
+  #define MANAGER_TASK_CORE 0                 //away from the sketch's loop() - and the only core on single core chips
+  #define MANAGER_TASK_INTERVAL_MS 10
+#endif
 
 typedef enum {
   //compatibility with wl_status_t (wl_definitions.h)
@@ -63,7 +97,8 @@ typedef enum {
   YY_CONNECTED_PEER_SERVER
 } yy_status_t;
 
-class YoYoWiFiManager : public AsyncWebHandler {
+//The manager itself - its capacities are set by YoYoWiFiManagerT<> below, which provides the storage for them
+class YoYoWiFiManagerBase : public AsyncWebHandler {
   public:
   typedef enum {
     YY_MODE_NONE,
@@ -71,12 +106,56 @@ class YoYoWiFiManager : public AsyncWebHandler {
     YY_MODE_PEER_CLIENT,
     YY_MODE_PEER_SERVER
   } yy_mode_t;
+  typedef enum {
+    YY_ROUTE_NETWORKS,
+    YY_ROUTE_CLIENTS,
+    YY_ROUTE_PEERS,
+    YY_ROUTE_CREDENTIALS,
+    YY_ROUTE_BROADCAST,
+    YY_ROUTE_BATCH,
+    YY_ROUTE_UPLOAD,
+    YY_ROUTE_FIRMWARE,
+    YY_ROUTE_MANIFEST,
+    YY_ROUTE_ASSET,
+    YY_ROUTE_METRICS,
+    YY_ROUTE_LOGS,
+    YY_ROUTE_USER       //the first id given to a route added with on()
+  } yy_route_t;
+
   yy_mode_t currentMode = YY_MODE_NONE;
   yy_mode_t nextMode = YY_MODE_NONE;
 
   private:
+    const yy_config_t config;
+
     bool running = false;
-    StaticJsonDocument<8192> broadcastMessageList;   //TODO: this should be dynamic?
+    YoYoBroadcastQueue broadcastQueue;
+    YoYoSeenMessages seenMessages;
+
+    //changes made by request handlers - applied by loop():
+    YoYoIntentQueue intents;
+    bool pushIntent(yy_intent_type_t type, JsonVariant message, IPAddress sender, int route = YY_ROUTE_NOT_FOUND);
+    void processIntents();
+    void applyIntent(yy_intent_t *intent, JsonVariant message);
+
+    #if defined(ESP32)
+      //task mode - loop() runs in a task of its own, and the sketch's calls are handed to it:
+      TaskHandle_t task = NULL;
+      uint32_t taskIntervalMs = MANAGER_TASK_INTERVAL_MS;
+      static void runTask(void *manager);
+      bool isOtherTask();
+      const char *taskFirmwarePath = NULL;
+
+      //what the sketch sees of the manager's state - updated by every loop():
+      portMUX_TYPE snapshotMux = portMUX_INITIALIZER_UNLOCKED;
+      struct {
+        yy_status_t status;
+        int peers;
+        int clients;
+      } snapshot = { YY_IDLE_STATUS, 0, 0 };
+      void updateSnapshot();
+    #endif
+    uint32_t broadcastSeq = 0;
 
     #if defined(ESP8266)
       ESP8266WiFiMulti wifiMulti;
@@ -89,7 +168,25 @@ class YoYoWiFiManager : public AsyncWebHandler {
     bool peerNetworkSet();
     
     yy_status_t currentStatus = YY_IDLE_STATUS;
-    uint32_t lastUpdatedMultiAtMs = 0;
+
+    //periodic work and time outs - added in the order of yy_timer_t:
+    YoYoScheduler scheduler;
+    typedef enum {
+      YY_TIMER_WIFI_MULTI,
+      YY_TIMER_CLIENT_LIST,
+      YY_TIMER_HTTP_CLIENTS,
+      YY_TIMER_WIFI_LED,
+      YY_TIMER_CLIENT_TIMEOUT,
+      YY_TIMER_SERVER_TIMEOUT,
+      YY_TIMER_PEER_ELECTION
+    } yy_timer_t;
+    static void onWiFiMultiDue(void *manager);
+    static void onClientListDue(void *manager);
+    static void onHTTPClientsDue(void *manager);
+    static void onWifiLEDDue(void *manager);
+    static void onClientTimeOut(void *manager);
+    static void onServerTimeOut(void *manager);
+    static void onPeerElectionDue(void *manager);
 
     const byte DNS_PORT = 53;
     DNSServer dnsServer;
@@ -98,28 +195,68 @@ class YoYoWiFiManager : public AsyncWebHandler {
     int webServerPort = 80;
     AsyncWebServer *webserver = NULL;
     bool startWebServerOnceConnected = false;
-    int activeRequests = 0;
 
-    uint32_t clientTimeOutAtMs = 0;
+    YoYoAdmission admission;
+    typedef enum {
+      YY_TRANSFER_NONE,
+      YY_TRANSFER_FIRMWARE,
+      YY_TRANSFER_ASSET
+    } yy_transfer_t;
+    yy_request_class_t getRequestClass(AsyncWebServerRequest *request);
+    void endRequest(AsyncWebServerRequest *request);
+
+    YoYoJsonArenaPool jsonArenas;
+    YoYoJsonArena *requestArena = NULL;
+    int requestArenaDepth = 0;
+    bool beginRequestArena();
+    void endRequestArena();
+    YoYoArenaAllocator requestAllocator();
+
+    YoYoMetrics metrics;
+    uint32_t connectingSinceMs = 0;
+    void sendMetrics(AsyncWebServerRequest *request);
+    void sendLogs(AsyncWebServerRequest *request);
+
+    bool clientTimedOut = false;
     void updateClientTimeOut();
     bool clientHasTimedOut();
 
     int currentClientCount = 0;
-    uint32_t lastUpdatedClientListAtMs = 0;
+    uint32_t stationGeneration = 0;   //moves on whenever the station list changes
+    uint32_t settingsGeneration = 0;  //moves on whenever the networks are written from here
 
-    uint32_t serverTimeOutAtMs = 0;
+    bool serverTimedOut = false;
     void updateServerTimeOut();
     bool serverHasTimedOut();
 
     yy_mode_t updateTimeOuts();
 
-    uint32_t lastScanNetworksAtMs = 0;
+    bool peerElection = false;
+    bool electionScanning = false;
+    uint32_t electionIntervalMs = PEER_ELECTION_INTERVAL;
+    uint32_t electionGeneration = 0;  //of the scan results the last election was decided on
+    yy_mode_t electionMode = YY_MODE_NONE;
+    void electPeerServer();
+    yy_mode_t getElectedMode(bool *rivalFound);
+
+    YoYoScan scan;
+    void updateScan();
 
     YoYoNetworkSettingsInterface *settings = NULL;
     uint8_t wifiLEDPin;
     bool wifiLEDOn;
 
     bool SPIFFS_ENABLED = false;
+    YoYoFileUpload fileUpload;
+    std::atomic<uint32_t> fileSystemGeneration;  //moves on whenever a file is changed - by an upload or a sync, on either task
+    YoYoFirmwareUpdate firmwareUpdate;
+
+    YoYoManifest manifest;
+    YoYoAssetSync assetSync;
+    int assetTransfers = 0;
+
+    typedef void (*assetSyncCallbackPtr)(const char *path, bool success, int done, int total);
+    assetSyncCallbackPtr onAssetSynchandler = NULL;
 
     typedef void (*voidCallbackPtr)();
     voidCallbackPtr onYY_CONNECTEDhandler = NULL;
@@ -128,8 +265,23 @@ class YoYoWiFiManager : public AsyncWebHandler {
     jsonCallbackPtr yoYoCommandGetHandler = NULL;
     jsonCallbackPtr yoYoCommandPostHandler = NULL;
 
+    typedef bool (*jsonVisitorPtr)(JsonVariant, void *);
+
+    typedef YoYoRoutes::routeCallbackPtr routeCallbackPtr;
+    YoYoRoutes routes;
+
+    typedef void (*broadcastCallbackPtr)(yy_broadcast_t *);
+    broadcastCallbackPtr onBroadcastReporthandler = NULL;
+
     String rootIndexFile = "/index.html";
 
+    typedef struct {
+      const char *name;
+      const char *path;
+    } template_variable_t;
+    template_variable_t templateVariables[TEMPLATE_VARIABLES_MAX];
+    int templateVariableCount = 0;
+
     void startWebServer();
     void stopWebServer();
 
@@ -140,10 +292,16 @@ class YoYoWiFiManager : public AsyncWebHandler {
     void startPeerNetworkAsAP();
     void stopPeerNetworkAsAP();
 
+    YoYoResponseCache responseCache;
+    void printResponse(int route, Print &response);
+    bool getResponseGeneration(int route, uint32_t *generation);
+    String getResponseAsJsonString(int route);
+    int findRoute(const char *path, WebRequestMethodComposite method);
+
     String getCredentialsAsJsonString();
     void getCredentialsAsJson(JsonDocument& jsonDoc);
+    void printPendingCredentials(JsonVariant pending, Print &response);
 
-    int scanNetworks();
     String getNetworksAsJsonString();
     void getNetworksAsJson(JsonDocument& jsonDoc);
 
@@ -152,6 +310,7 @@ class YoYoWiFiManager : public AsyncWebHandler {
 
     String getPeersAsJsonString();
     void getPeersAsJson(JsonDocument& jsonDoc);
+    static bool addPeerFromGateway(JsonVariant peer, void *context);
     void createNestedPeer(JsonDocument& jsonDoc, IPAddress *ip, uint8_t *macAddress, bool localhost = false, bool gateway = false);
     int updateClientList();
     bool getPeerN(int n, IPAddress *ipAddress, uint8_t *macAddress);
@@ -161,8 +320,11 @@ class YoYoWiFiManager : public AsyncWebHandler {
     #endif
     tcpip_adapter_sta_list_t adapter_sta_list;
 
-    int POST(const char *server, const char *path, const char *payload, char *contentType, char *response = NULL);
-    int GET(const char *server, const char *path, char *response);
+    YoYoHTTPClientPool httpClientPool;
+    int POST(const char *server, const char *path, const char *payload, char *contentType, char *response = NULL, size_t responseSize = YY_HTTP_RESPONSE_MAX_BYTES);
+    int POST(const char *server, const char *path, uint8_t *payload, size_t length, char *contentType, char *response = NULL, size_t responseSize = YY_HTTP_RESPONSE_MAX_BYTES);
+    int GET(const char *server, const char *path, char *response, size_t responseSize = YY_HTTP_RESPONSE_MAX_BYTES);
+    size_t readResponse(HTTPClient *http, char *response, size_t responseSize);
 
     void setMode(yy_mode_t mode, bool update = false);
     bool updateMode();
@@ -171,8 +333,11 @@ class YoYoWiFiManager : public AsyncWebHandler {
 
     void printWiFiDiag();
     void getModeAsString(yy_mode_t mode, char *string);
+  protected:
+    YoYoWiFiManagerBase(const yy_config_t &config);
+    void setStorage(yy_broadcast_t *broadcasts, yy_peer_delivery_t *deliveries, YoYoJsonArena *arenas, uint8_t *arenaMemory, YoYoResponseCache::entry_t *cacheEntries, uint8_t *uploadBuffer, YoYoAssetSync::file_t *assetFiles, YoYoHistogram *routeHistograms, YoYoAdmission::entry_t *requests, YoYoIntentQueue::cell_t *intentCells, YoYoHTTPClientPool::Connection *httpConnections, char *logBuffer, YoYoRoutes::route_t *routeTable, uint8_t *routeOrder);
+
   public:
-    YoYoWiFiManager();
 
     void init(YoYoNetworkSettingsInterface *settings = NULL, voidCallbackPtr onYY_CONNECTEDhandler = NULL, jsonCallbackPtr getHandler = NULL, jsonCallbackPtr postHandler = NULL, bool startWebServerOnceConnected = false, int webServerPort = 80, int wifiLEDPin = LED_BUILTIN, bool wifiLEDOn = LED_BUILTIN_ON);
     boolean begin(char const *apName, char const *apPassword = NULL, bool autoconnect = true);
@@ -181,16 +346,24 @@ class YoYoWiFiManager : public AsyncWebHandler {
     void connect(char const *ssid, char const *password);
 
     uint8_t loop();
+    #if defined(ESP32)
+      bool startTask(uint32_t intervalMs = MANAGER_TASK_INTERVAL_MS, int core = MANAGER_TASK_CORE, int priority = MANAGER_TASK_PRIORITY);
+      bool isTaskRunning();
+    #endif
     yy_status_t getStatus();
     uint32_t getChipId();
 
     bool findNetwork(char const *ssid, char *matchingSSID, bool autocomplete = false, bool autocorrect = false, int autocorrectError = 0);
 
+    int on(const char *path, WebRequestMethodComposite methods, routeCallbackPtr handler = NULL);
+    int getRoute(const char *path, WebRequestMethodComposite method = HTTP_ANY);
+
     //AsyncWebHandler:
     bool canHandle(AsyncWebServerRequest *request);
     void handleRequest(AsyncWebServerRequest *request);
     void handleCaptivePortalRequest(AsyncWebServerRequest *request);
     void handleBody(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total);
+    void handleUpload(AsyncWebServerRequest *request, const String& filename, size_t index, uint8_t *data, size_t len, bool final);
 
     bool setCredentials(JsonVariant json);
 
@@ -199,11 +372,33 @@ class YoYoWiFiManager : public AsyncWebHandler {
     bool hasClients();
     int countClients();
 
+    uint32_t getDuplicateBroadcastCount();
+    uint32_t getDroppedIntentCount();
+    uint32_t getResponseCacheHits();
+    uint32_t getResponseCacheMisses();
+    size_t getJsonArenaHighWaterBytes();
+    uint32_t getJsonArenaExhaustedCount();
+    uint32_t getJsonArenaOverflowCount();
+    YoYoMetrics &getMetrics();
+    uint32_t getMsUntilNextDue();
+    void setSerialLogging(bool serial);
+    void setBroadcastReportHandler(broadcastCallbackPtr onBroadcastReporthandler);
+    void setPeerElection(bool election);
+
     bool isEspressif(uint8_t *macAddress);
     void setRootIndexFile(String rootIndexFile);
 
-    int POST(const char *server, const char *path, JsonVariant payload, char *response = NULL);
+    bool distributeFirmware(const char *path = YY_FIRMWARE_PATH);
+    bool isFirmwareUpdatePending();
+
+    bool syncAssets();
+    bool isAssetSyncPending();
+    void setAssetSyncHandler(assetSyncCallbackPtr onAssetSynchandler);
+    bool addTemplateVariable(const char *name, const char *path);
+
+    int POST(const char *server, const char *path, JsonVariant payload, char *response = NULL, size_t responseSize = YY_HTTP_RESPONSE_MAX_BYTES);
     int GET(const char *server, const char *path, JsonDocument &response);
+    int GET(const char *server, const char *path, JsonDocument &filter, jsonVisitorPtr visitor, void *context = NULL);
 
     void setWifiLED(bool value);
 
@@ -212,33 +407,116 @@ class YoYoWiFiManager : public AsyncWebHandler {
 
   private:
     bool mac_addr_to_c_str(uint8_t *mac, char *str);
+    bool ip_addr_to_c_str(IPAddress ip, char *str);
+    char *getConnectedSSID(char *ssid);
     int getOUI(char *mac);
     int getOUI(uint8_t *mac);
     int getOUI(uint8_t a, uint8_t b, uint8_t c, uint8_t d = 0, uint8_t e = 0, uint8_t f = 0);
 
     void sendFile(AsyncWebServerRequest * request, String path);
+    int getRange(AsyncWebServerRequest *request, const char *etag, size_t size, size_t *start, size_t *length);
+    void sendFirmware(AsyncWebServerRequest *request);
+    bool isFirmwareSource(JsonVariant payload, IPAddress sender);
+    bool onFirmwareMessage(JsonVariant payload);
+
+    void updateManifest();
+    int printManifest(Print &response);
+    void sendAsset(AsyncWebServerRequest *request);
+    void syncNextAsset();
     void sendIndexFile(AsyncWebServerRequest * request);
     String getMimeType(String filename);
+    bool processTemplate(const char *name, String &result);
 
-    void onYoYoRequestGET(AsyncWebServerRequest *request);
-    void onYoYoRequestPOST(uint8_t *data, size_t len, AsyncWebServerRequest *request);
-    void onYoYoRequestUPLOAD(uint8_t *data, size_t len, AsyncWebServerRequest *request);
+    void onYoYoRequestGET(AsyncWebServerRequest *request, int route);
+    void onYoYoRequestPOST(uint8_t *data, size_t len, AsyncWebServerRequest *request, int route);
+    void onYoYoRequestUPLOAD(AsyncWebServerRequest *request);
+    void writeUpload(AsyncWebServerRequest *request, String path, size_t index, uint8_t *data, size_t len, bool final);
     void onYoYoRequestDELETE(uint8_t *data, size_t len, AsyncWebServerRequest *request);
     
-    void onYoYoMessageGET(AsyncWebServerRequest *request);
-    void onYoYoMessagePOST(JsonVariant message, AsyncWebServerRequest *request);
+    int onYoYoMessageGET(int route, const char *path, Print &response);
+    int onYoYoMessagePOST(int route, JsonVariant message, IPAddress sender, Print &response);
+    bool applyMessagePOST(int route, JsonVariant message);
+    bool saveCredentials(JsonVariant json);
+    void setMessagePath(JsonVariant message, int route, const char *path);
+    int onYoYoBatchPOST(JsonVariant batch, IPAddress sender, Print &response);
+    void sendResponse(AsyncWebServerRequest *request, AsyncResponseStream *response, int httpResponseCode);
+    void sendUnavailable(AsyncWebServerRequest *request, int retryAfterS);
     void onYoYoMessageDELETE(JsonVariant message, AsyncWebServerRequest *request);
 
-    void addBroadcastMessage(JsonVariant message);
+    int onYoYoBroadcastPOST(JsonVariant message, IPAddress sender);
+    void receiveBroadcast(JsonVariant message, IPAddress sender);
+    void addBroadcastMessage(JsonVariant message, IPAddress sender);
     void processBroadcastMessageList();
-    bool broadcastMessage(JsonVariant message);
+    void startBroadcast(yy_broadcast_t *broadcast);
+    bool broadcastMessage(yy_broadcast_t *broadcast);
+    int postBroadcast(yy_broadcast_t *broadcast, yy_peer_delivery_t *peer);
+    bool isRetryable(int httpResponseCode);
+};
 
-    void getNetworks(AsyncWebServerRequest *request);
-    void getClients(AsyncWebServerRequest *request);
-    void getPeers(AsyncWebServerRequest *request);
-    void getCredentials(AsyncWebServerRequest *request);
-    
-    bool setCredentials(JsonVariant message, AsyncWebServerRequest *request);
+//A manager with the capacities given by Config - features configured out take no storage
+template<typename Config>
+class YoYoWiFiManagerT : public YoYoWiFiManagerBase {
+  private:
+    static const bool fileTransfer = Config::fileTransfer;
+
+    YoYoStorage<yy_broadcast_t, Config::broadcastQueueDepth> broadcasts;
+    YoYoStorage<yy_peer_delivery_t, Config::broadcastQueueDepth * Config::maxPeers> deliveries;
+    YoYoStorage<YoYoJsonArena, Config::requestArenas> arenas;
+    uint8_t arenaMemory[Config::requestArenas * Config::requestArenaBytes] __attribute__((aligned(YY_JSON_ARENA_ALIGNMENT)));
+    YoYoStorage<YoYoResponseCache::entry_t, Config::responseCacheSize> cacheEntries;
+    YoYoStorage<uint8_t, fileTransfer ? Config::uploadBufferBytes : 0> uploadBuffer;
+    YoYoStorage<YoYoAssetSync::file_t, fileTransfer ? Config::assetSyncMaxFiles : 0> assetFiles;
+    YoYoStorage<YoYoHistogram, Config::metricsRoutes> routeHistograms;
+    YoYoStorage<YoYoAdmission::entry_t, Config::maxStaticRequests + Config::maxApiRequests + Config::maxCaptiveRequests + Config::maxTransferRequests> requests;
+    YoYoStorage<YoYoIntentQueue::cell_t, Config::intentQueueDepth> intentCells;
+    YoYoStorage<YoYoHTTPClientPool::Connection, Config::httpClients> httpConnections;
+    YoYoStorage<char, Config::logBufferBytes> logBuffer;
+    YoYoStorage<YoYoRoutes::route_t, Config::maxRoutes> routeTable;
+    YoYoStorage<uint8_t, Config::maxRoutes> routeOrder;
+
+    static yy_config_t getConfig() {
+      yy_config_t config = {
+        Config::broadcastQueueDepth,
+        Config::maxPeers,
+        Config::maxCredentials,
+        Config::requestArenas,
+        Config::requestArenaBytes,
+        Config::documentBytes,
+        Config::responseCacheSize,
+        Config::fileTransfer,
+        Config::uploadBufferBytes,
+        Config::assetSyncMaxFiles,
+        Config::assetTransfers,
+        Config::metricsRoutes,
+        Config::maxStaticRequests,
+        Config::maxApiRequests,
+        Config::maxCaptiveRequests,
+        Config::maxTransferRequests,
+        Config::minFreeHeapBytes,
+        Config::intentQueueDepth,
+        Config::httpClients,
+        Config::logBufferBytes,
+        Config::maxRoutes
+      };
+
+      return(config);
+    }
+
+  public:
+    YoYoWiFiManagerT() : YoYoWiFiManagerBase(getConfig()) {
+      static_assert(Config::requestArenas > 0 && Config::requestArenaBytes > 0, "every request needs an arena");
+      static_assert(Config::requestArenaBytes % YY_JSON_ARENA_ALIGNMENT == 0, "requestArenaBytes must be a multiple of YY_JSON_ARENA_ALIGNMENT");
+      static_assert(Config::broadcastQueueDepth == 0 || Config::maxPeers > 0, "broadcasts need at least one peer");
+      static_assert(Config::intentQueueDepth > 0 && (Config::intentQueueDepth & (Config::intentQueueDepth - 1)) == 0, "intentQueueDepth must be a power of 2");
+      static_assert(!Config::fileTransfer || (Config::uploadBufferBytes > 0 && Config::uploadBufferBytes % 256 == 0), "uploadBufferBytes must be a whole number of flash pages");
+      static_assert(!Config::fileTransfer || (Config::assetTransfers > 0 && Config::assetTransfers <= Config::maxTransferRequests), "assetTransfers must be between 1 and maxTransferRequests");
+      static_assert(Config::httpClients > 0, "peers need at least one outbound connection");
+      static_assert(Config::maxRoutes >= YY_ROUTE_USER && Config::maxRoutes <= 256, "maxRoutes must hold the built-in endpoints - and no more than 256");
+
+      setStorage(broadcasts.get(), deliveries.get(), arenas.get(), arenaMemory, cacheEntries.get(), uploadBuffer.get(), assetFiles.get(), routeHistograms.get(), requests.get(), intentCells.get(), httpConnections.get(), logBuffer.get(), routeTable.get(), routeOrder.get());
+    }
 };
 
+typedef YoYoWiFiManagerT<YoYoDefaultConfig> YoYoWiFiManager;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,117 @@
+#ifndef YoYoAdmission_h
+#define YoYoAdmission_h
+
+#define YY_ADMISSION_RETRY_AFTER_S 1
+
+typedef enum {
+  YY_REQUEST_STATIC,              //files from the file system
+  YY_REQUEST_API,                 //built-in and custom endpoints
+  YY_REQUEST_CAPTIVE,             //operating systems probing for a captive portal
+  YY_REQUEST_TRANSFER,            //peers fetching firmware or files - in flight for as long as the transfer takes
+  YY_REQUEST_CLASSES
+} yy_request_class_t;
+
+//The requests in flight - from being accepted until their connection closes - with a limit for each class of request
+class YoYoAdmission {
+  public:
+    typedef struct {
+      void *request;              //NULL if the entry is free
+      uint8_t requestClass;
+      uint8_t transfer;           //what to give back once the request has gone - up to the owner
+    } entry_t;
+
+  private:
+    entry_t *entries = NULL;
+    int size = 0;
+    int limits[YY_REQUEST_CLASSES];
+    int inFlight[YY_REQUEST_CLASSES];
+    int total = 0;
+    uint32_t shed[YY_REQUEST_CLASSES];
+
+    entry_t *find(void *request) {
+      entry_t *result = NULL;
+
+      for(int n = 0; n < size && !result; ++n) {
+        if(entries[n].request == request) result = &entries[n];
+      }
+
+      return(result);
+    }
+
+  public:
+    YoYoAdmission() {
+      memset(limits, 0, sizeof(limits));
+      memset(inFlight, 0, sizeof(inFlight));
+      memset(shed, 0, sizeof(shed));
+    }
+
+    //entries has room for the sum of the limits:
+    void setStorage(entry_t *entries, int size) {
+      this -> entries = entries;
+      this -> size = size;
+
+      for(int n = 0; n < size; ++n) entries[n].request = NULL;
+    }
+
+    void setLimit(yy_request_class_t requestClass, int limit) {
+      limits[requestClass] = limit;
+    }
+
+    //Returns false (and counts it as shed) if as many requests of this class are already in flight as allowed:
+    bool admit(void *request, yy_request_class_t requestClass) {
+      entry_t *entry = NULL;
+
+      if(inFlight[requestClass] < limits[requestClass]) entry = find(NULL);
+
+      if(entry) {
+        entry -> request = request;
+        entry -> requestClass = requestClass;
+        entry -> transfer = 0;
+        inFlight[requestClass]++;
+        total++;
+      }
+      else shed[requestClass]++;
+
+      return(entry != NULL);
+    }
+
+    void refuse(yy_request_class_t requestClass) {
+      shed[requestClass]++;
+    }
+
+    bool setTransfer(void *request, uint8_t transfer) {
+      entry_t *entry = find(request);
+      if(entry) entry -> transfer = transfer;
+
+      return(entry != NULL);
+    }
+
+    //Forgets a request once it has gone - returns its transfer:
+    uint8_t end(void *request) {
+      uint8_t result = 0;
+      entry_t *entry = request ? find(request) : NULL;
+
+      if(entry) {
+        result = entry -> transfer;
+        inFlight[entry -> requestClass]--;
+        total--;
+        entry -> request = NULL;
+      }
+
+      return(result);
+    }
+
+    int getInFlight() {
+      return(total);
+    }
+
+    int getInFlight(yy_request_class_t requestClass) {
+      return(inFlight[requestClass]);
+    }
+
+    uint32_t getShed(yy_request_class_t requestClass) {
+      return(shed[requestClass]);
+    }
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef YoYoAssetSync_h
+#define YoYoAssetSync_h
+
+#define YY_MANIFEST_URI "/yoyo/manifest"
+#define YY_ASSET_URI "/yoyo/asset"
+#define YY_ASSET_MANIFEST_MAX_BYTES 2048
+#define YY_ASSET_MAX_ATTEMPTS 5
+#define YY_ASSET_RETRY_MS 1000
+
+//The files that differ from the peer server's - fetched one at a time
+class YoYoAssetSync {
+  public:
+    typedef struct {
+      char path[YY_UPLOAD_PATH_MAX_LENGTH];
+      char md5[33];
+    } file_t;
+
+  private:
+    file_t *files = NULL;
+    int maxFiles = 0;
+    int count = 0;
+    int next = 0;
+    int failed = 0;
+
+    uint8_t attempts = 0;
+    uint32_t nextAttemptAtMs = 0;
+
+  public:
+    void setStorage(file_t *files, int maxFiles) {
+      this -> files = files;
+      this -> maxFiles = maxFiles;
+    }
+
+    void clear() {
+      count = 0;
+      next = 0;
+      failed = 0;
+      attempts = 0;
+    }
+
+    bool add(const char *path, const char *md5) {
+      bool success = false;
+
+      if(count < maxFiles && path && md5 && strlen(path) < YY_UPLOAD_PATH_MAX_LENGTH && strlen(md5) == 32) {
+        strcpy(files[count].path, path);
+        strcpy(files[count].md5, md5);
+        count++;
+        success = true;
+      }
+
+      return(success);
+    }
+
+    bool isPending() {
+      return(next < count);
+    }
+
+    bool isDue() {
+      return(isPending() && (int32_t)(millis() - nextAttemptAtMs) >= 0);
+    }
+
+    //The next file to fetch:
+    const char *getPath() {
+      return(isPending() ? files[next].path : NULL);
+    }
+
+    const char *getMD5() {
+      return(isPending() ? files[next].md5 : NULL);
+    }
+
+    //Moves on to the next file:
+    void advance(bool success) {
+      if(isPending()) {
+        if(!success) failed++;
+        next++;
+        attempts = 0;
+        nextAttemptAtMs = millis();
+      }
+    }
+
+    //Tries the same file again later - returns false once it has been tried too many times:
+    bool retry() {
+      bool result = (++attempts < YY_ASSET_MAX_ATTEMPTS);
+      if(result) nextAttemptAtMs = millis() + YY_ASSET_RETRY_MS * attempts;
+
+      return(result);
+    }
+
+    int getDone() {
+      return(next);
+    }
+
+    int getFailed() {
+      return(failed);
+    }
+
+    int getTotal() {
+      return(count);
+    }
+};
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef YoYoBroadcastQueue_h
+#define YoYoBroadcastQueue_h
+
+#define YY_BROADCAST_MAX_BYTES 512
+#define YY_BROADCAST_MAX_ATTEMPTS 5
+#define YY_BROADCAST_RETRY_MIN_MS 250
+
+typedef enum {
+  YY_DELIVERY_PENDING,
+  YY_DELIVERY_ACKNOWLEDGED,
+  YY_DELIVERY_FAILED
+} yy_delivery_status_t;
+
+typedef struct {
+  IPAddress ip;
+  yy_delivery_status_t status;
+  uint8_t attempts;
+  int responseCode;               //of the last attempt
+  uint32_t nextAttemptAtMs;
+  uint32_t deliveredAtMs;         //when acknowledged
+  bool json;                      //the peer doesn't accept MessagePack
+} yy_peer_delivery_t;
+
+typedef struct {
+  uint32_t origin;
+  uint32_t seq;
+  int route;                      //the local route id of the path
+  IPAddress sender;               //never delivered back to the sender
+  uint32_t queuedAtMs;
+  bool started;                   //the peers have been resolved
+  int peerCount;
+  yy_peer_delivery_t *peers;      //room for getMaxPeers()
+  size_t length;
+  char body[YY_BROADCAST_MAX_BYTES]; //the message serialised as MessagePack
+} yy_broadcast_t;
+
+//A fixed-size FIFO of broadcast messages waiting to be delivered - in storage provided by the owner
+class YoYoBroadcastQueue {
+  private:
+    yy_broadcast_t *messages = NULL;
+    int depth = 0;
+    int maxPeers = 0;
+    int head = 0;
+    int count = 0;
+    int maxCount = 0;
+
+  public:
+    //peers has room for maxPeers deliveries for each of the depth messages - a depth of 0 disables broadcasts:
+    void setStorage(yy_broadcast_t *messages, int depth, yy_peer_delivery_t *peers, int maxPeers) {
+      this -> messages = messages;
+      this -> depth = depth;
+      this -> maxPeers = maxPeers;
+
+      for(int n = 0; n < depth; ++n) messages[n].peers = &peers[n * maxPeers];
+    }
+
+    //Returns the slot at the back of the queue to be filled, or NULL if full:
+    yy_broadcast_t *push() {
+      yy_broadcast_t *result = NULL;
+
+      if(!isFull()) {
+        result = &messages[(head + count) % depth];
+        result -> started = false;
+        result -> peerCount = 0;
+        result -> length = 0;
+        if(++count > maxCount) maxCount = count;
+      }
+
+      return(result);
+    }
+
+    yy_broadcast_t *front() {
+      return(isEmpty() ? NULL : &messages[head]);
+    }
+
+    void pop() {
+      if(!isEmpty()) {
+        head = (head + 1) % depth;
+        count--;
+      }
+    }
+
+    int size() {
+      return(count);
+    }
+
+    //The most messages that have been waiting at once:
+    int getHighWater() {
+      return(maxCount);
+    }
+
+    bool isEmpty() {
+      return(count == 0);
+    }
+
+    bool isFull() {
+      return(count == depth);
+    }
+
+    bool isEnabled() {
+      return(depth > 0);
+    }
+
+    int getMaxPeers() {
+      return(maxPeers);
+    }
+};
+
+#endif
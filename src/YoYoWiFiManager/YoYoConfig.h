@@ -0,0 +1,100 @@
+#ifndef YoYoConfig_h
+#define YoYoConfig_h
+
+#define YY_SOFTAP_MAX_CONNECTIONS 4          //the core's default
+
+//The default capacities - a sketch can derive its own config from this and pass it to YoYoWiFiManagerT<>.
+//An ESP8266 has a fraction of an ESP32's RAM - so it gets smaller ones
+#if defined(ESP8266)
+struct YoYoDefaultConfig {
+  static const int broadcastQueueDepth = 4;         //0 disables broadcasts
+  static const int maxPeers = YY_SOFTAP_MAX_CONNECTIONS;
+  static const int maxCredentials = 0;              //0 leaves it to the settings
+  static const int requestArenas = 1;               //requests are handled one at a time, on the web server's task
+  static const size_t requestArenaBytes = 2560;
+  static const size_t documentBytes = 768;          //each JSON document made for a request
+  static const int responseCacheSize = 2;           //0 disables the response cache
+  static const bool fileTransfer = true;            //uploads, firmware distribution and asset sync
+  static const size_t uploadBufferBytes = 512;      //a whole number of 256 byte flash pages
+  static const int assetSyncMaxFiles = 16;
+  static const int assetTransfers = 1;              //peers fetching files at once - each one a transfer request
+  static const int metricsRoutes = 12;              //routes with their own request histogram - 0 counts every request together
+  static const int maxStaticRequests = 6;           //requests in flight for each class - more are sent a 503. A browser opens up to 6 connections
+  static const int maxApiRequests = 4;
+  static const int maxCaptiveRequests = 2;
+  static const int maxTransferRequests = 2;         //firmware and files sent to peers
+  static const uint32_t minFreeHeapBytes = 6144;    //below this every request is sent a 503
+  static const int intentQueueDepth = 4;            //changes waiting for loop() - a power of 2
+  static const int httpClients = 2;                 //outbound connections kept open - to the peer server and one other host
+  static const size_t logBufferBytes = 512;         //the most recent log messages - 0 keeps none
+  static const int maxRoutes = 16;                  //the built-in endpoints and those added with on()
+};
+#else
+struct YoYoDefaultConfig {
+  static const int broadcastQueueDepth = 8;         //0 disables broadcasts
+  static const int maxPeers = ESP_WIFI_MAX_CONN_NUM;
+  static const int maxCredentials = 0;              //0 leaves it to the settings
+  static const int requestArenas = 1;               //requests are handled one at a time, on the web server's task
+  static const size_t requestArenaBytes = 4096;
+  static const size_t documentBytes = 1024;         //each JSON document made for a request
+  static const int responseCacheSize = 4;           //0 disables the response cache
+  static const bool fileTransfer = true;            //uploads, firmware distribution and asset sync
+  static const size_t uploadBufferBytes = 1024;     //a whole number of 256 byte flash pages
+  static const int assetSyncMaxFiles = 32;
+  static const int assetTransfers = 2;              //peers fetching files at once - each one a transfer request
+  static const int metricsRoutes = 16;              //routes with their own request histogram - 0 counts every request together
+  static const int maxStaticRequests = 8;           //requests in flight for each class - more are sent a 503. A browser opens up to 6 connections
+  static const int maxApiRequests = 6;
+  static const int maxCaptiveRequests = 2;
+  static const int maxTransferRequests = 4;         //firmware and files sent to peers
+  static const uint32_t minFreeHeapBytes = 8192;    //below this every request is sent a 503
+  static const int intentQueueDepth = 4;            //changes waiting for loop() - a power of 2
+  static const int httpClients = 4;                 //outbound connections kept open
+  static const size_t logBufferBytes = 1024;        //the most recent log messages - 0 keeps none
+  static const int maxRoutes = 24;                  //the built-in endpoints and those added with on()
+};
+#endif
+
+//The same capacities at run time - as seen by the compiled core
+typedef struct {
+  int broadcastQueueDepth;
+  int maxPeers;
+  int maxCredentials;
+  int requestArenas;
+  size_t requestArenaBytes;
+  size_t documentBytes;
+  int responseCacheSize;
+  bool fileTransfer;
+  size_t uploadBufferBytes;
+  int assetSyncMaxFiles;
+  int assetTransfers;
+  int metricsRoutes;
+  int maxStaticRequests;
+  int maxApiRequests;
+  int maxCaptiveRequests;
+  int maxTransferRequests;
+  uint32_t minFreeHeapBytes;
+  int intentQueueDepth;
+  int httpClients;
+  size_t logBufferBytes;
+  int maxRoutes;
+} yy_config_t;
+
+//A fixed-size array that takes next to no room when its size is 0
+template<typename T, int N>
+struct YoYoStorage {
+  T items[N];
+
+  T *get() {
+    return(items);
+  }
+};
+
+template<typename T>
+struct YoYoStorage<T, 0> {
+  T *get() {
+    return(NULL);
+  }
+};
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef YoYoFileUpload_h
+#define YoYoFileUpload_h
+
+#include <MD5Builder.h>
+#include "YoYoFirmwareUpdate.h"
+
+#define YY_UPLOAD_PATH_MAX_LENGTH 32           //SPIFFS_OBJ_NAME_LEN
+#define YY_UPLOAD_TEMP_PATH "/yoyo-upload.tmp"
+
+//A single file upload, streamed to a temporary file in page-sized writes and renamed into place once complete and verified.
+//Uploads arrive on the web server's task and asset syncs run in loop() - whichever claims the upload first has the file to itself
+class YoYoFileUpload {
+  private:
+    void *owner = NULL;                     //the request (or sync) the upload belongs to
+    char path[YY_UPLOAD_PATH_MAX_LENGTH];
+    File file;
+    MD5Builder md5;
+
+    uint8_t *buffer = NULL;                 //a whole number of 256 byte flash pages
+    size_t bufferSize = 0;
+    size_t buffered = 0;
+
+    size_t bytes = 0;
+    uint32_t startedAtMs = 0;
+    uint32_t durationMs = 0;
+    bool complete = false;
+    bool corrupt = false;                   //didn't match the expected MD5
+    bool failed = false;
+
+    #if defined(ESP32)
+      portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+      void lock() { portENTER_CRITICAL(&mux); }
+      void unlock() { portEXIT_CRITICAL(&mux); }
+    #else
+      void lock() {}
+      void unlock() {}
+    #endif
+
+    //Takes the upload for owner - only one can have it:
+    bool claim(void *owner) {
+      bool success = false;
+
+      lock();
+      if(this -> owner == NULL) {
+        this -> owner = owner;
+        success = true;
+      }
+      unlock();
+
+      return(success);
+    }
+
+    //Somewhere under the root - but not the temporary file, which would be removed on renaming it, and not the firmware image peers are served:
+    static bool isValidPath(const char *path) {
+      return(path && path[0] == '/' && path[1] != '\0' && strlen(path) < YY_UPLOAD_PATH_MAX_LENGTH && !strstr(path, "..") &&
+              strcmp(path, YY_UPLOAD_TEMP_PATH) != 0 && strcmp(path, YY_FIRMWARE_PATH) != 0);
+    }
+
+    bool flush() {
+      if(buffered > 0) {
+        if(file.write(buffer, buffered) != buffered) failed = true;
+        buffered = 0;
+      }
+
+      return(!failed);
+    }
+
+  public:
+    //A size of 0 disables uploads:
+    void setStorage(uint8_t *buffer, size_t size) {
+      this -> buffer = buffer;
+      bufferSize = size;
+    }
+
+    bool isEnabled() {
+      return(bufferSize > 0);
+    }
+
+    //Returns false if another upload is in progress, the path is reserved or invalid, or the temporary file can't be created:
+    bool begin(void *owner, const char *path) {
+      bool success = false;
+
+      //the file is only opened once the upload is ours:
+      if(isEnabled() && owner && isValidPath(path) && claim(owner)) {
+        file = SPIFFS.open(YY_UPLOAD_TEMP_PATH, "w");
+
+        if(file) {
+          strcpy(this -> path, path);
+          md5.begin();
+          buffered = 0;
+          bytes = 0;
+          startedAtMs = millis();
+          durationMs = 0;
+          complete = false;
+          corrupt = false;
+          failed = false;
+          success = true;
+        }
+        else release();
+      }
+
+      return(success);
+    }
+
+    bool write(const uint8_t *data, size_t len) {
+      md5.add((uint8_t *) data, len);
+      bytes += len;
+
+      while(len > 0 && !failed) {
+        size_t n = (len < bufferSize - buffered) ? len : bufferSize - buffered;
+        memcpy(&buffer[buffered], data, n);
+        buffered += n;
+        data += n;
+        len -= n;
+
+        if(buffered == bufferSize) flush();
+      }
+
+      return(!failed);
+    }
+
+    //Returns true if the file was written in full and matches expectedMD5 (if given) - and is now in place at path.
+    //The upload still belongs to its owner until release():
+    bool end(const char *expectedMD5 = NULL) {
+      flush();
+      file.close();
+      md5.calculate();
+      durationMs = millis() - startedAtMs;
+      complete = true;
+
+      if(expectedMD5 && expectedMD5[0] != '\0' && !md5.toString().equalsIgnoreCase(expectedMD5)) {
+        corrupt = true;
+        failed = true;
+      }
+
+      if(!failed) {
+        //the old file is only removed once the new one is known to be good:
+        if(SPIFFS.exists(path)) SPIFFS.remove(path);
+        if(!SPIFFS.rename(YY_UPLOAD_TEMP_PATH, path)) failed = true;
+      }
+      if(failed) SPIFFS.remove(YY_UPLOAD_TEMP_PATH);
+
+      return(!failed);
+    }
+
+    void release() {
+      lock();
+      owner = NULL;
+      unlock();
+    }
+
+    //Discards an upload that was cut short:
+    void abort() {
+      if(isActive() && !complete) {
+        file.close();
+        SPIFFS.remove(YY_UPLOAD_TEMP_PATH);
+        failed = true;
+      }
+      release();
+    }
+
+    bool isActive() {
+      lock();
+      bool result = (owner != NULL);
+      unlock();
+
+      return(result);
+    }
+
+    //Only the owner touches the file - so once this is true it stays true until the owner lets go:
+    bool isOwner(void *owner) {
+      lock();
+      bool result = (owner != NULL && this -> owner == owner);
+      unlock();
+
+      return(result);
+    }
+
+    bool isComplete() {
+      return(complete);
+    }
+
+    bool isCorrupt() {
+      return(corrupt);
+    }
+
+    bool hasFailed() {
+      return(failed);
+    }
+
+    const char *getPath() {
+      return(path);
+    }
+
+    size_t getBytes() {
+      return(bytes);
+    }
+
+    uint32_t getDurationMs() {
+      return(durationMs);
+    }
+
+    String getMD5() {
+      return(md5.toString());
+    }
+};
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef YoYoFirmwareUpdate_h
+#define YoYoFirmwareUpdate_h
+
+#include <MD5Builder.h>
+
+#define YY_FIRMWARE_PATH "/firmware.bin"
+#define YY_FIRMWARE_URI "/yoyo/firmware"
+#define YY_FIRMWARE_MAX_TRANSFERS 2          //peers fetching the image at once
+#define YY_FIRMWARE_MAX_ATTEMPTS 8
+#define YY_FIRMWARE_RETRY_MIN_MS 5000
+
+//A firmware image shared with the peer network - served from the file system by one device, and fetched and flashed by the others
+class YoYoFirmwareUpdate {
+  private:
+    //shared:
+    const char *path = NULL;
+    char md5[33];
+    size_t size = 0;
+    int transfers = 0;
+
+    //pending:
+    bool pending = false;
+    char host[16];
+    uint16_t port = 80;
+    char pendingMD5[33];
+    uint8_t attempts = 0;
+    uint32_t nextAttemptAtMs = 0;
+
+  public:
+    //Firmware is only taken from the peer server (the gateway) - as a broadcast it sent itself, of an image it serves itself:
+    static bool isSource(const char *host, IPAddress sender, IPAddress gateway) {
+      IPAddress address;
+
+      return((uint32_t) gateway != 0 && (uint32_t) sender == (uint32_t) gateway && address.fromString(host) && (uint32_t) address == (uint32_t) gateway);
+    }
+
+    //Shares the image at path - returns false if it can't be read:
+    bool share(const char *path) {
+      bool success = false;
+      File file = SPIFFS.open(path, "r");
+
+      if(file && file.size() > 0) {
+        MD5Builder builder;
+        builder.begin();
+        builder.addStream(file, file.size());
+        builder.calculate();
+        builder.getChars(md5);
+
+        this -> path = path;
+        size = file.size();
+        success = true;
+      }
+      if(file) file.close();
+
+      return(success);
+    }
+
+    bool isShared() {
+      return(path != NULL);
+    }
+
+    const char *getPath() {
+      return(path);
+    }
+
+    const char *getMD5() {
+      return(md5);
+    }
+
+    size_t getSize() {
+      return(size);
+    }
+
+    //Returns false if too many peers are already fetching the image:
+    bool beginTransfer() {
+      bool success = (transfers < YY_FIRMWARE_MAX_TRANSFERS);
+      if(success) transfers++;
+
+      return(success);
+    }
+
+    void endTransfer() {
+      if(transfers > 0) transfers--;
+    }
+
+    //Schedules an update from host - unless already running that image (or sharing it):
+    bool schedule(const char *host, uint16_t port, const char *md5) {
+      bool success = false;
+
+      if(pending && md5 && strcasecmp(pendingMD5, md5) == 0) {
+        success = true;   //already scheduled
+      }
+      else if(host && md5 && strlen(host) < sizeof(this -> host) && strlen(md5) == 32 && !ESP.getSketchMD5().equalsIgnoreCase(md5) && !(isShared() && strcasecmp(this -> md5, md5) == 0)) {
+        strcpy(this -> host, host);
+        this -> port = port;
+        strcpy(pendingMD5, md5);
+        attempts = 0;
+        //so that peers don't all ask at once:
+        nextAttemptAtMs = millis() + random(YY_FIRMWARE_RETRY_MIN_MS);
+        pending = true;
+        success = true;
+      }
+
+      return(success);
+    }
+
+    bool isPending() {
+      return(pending);
+    }
+
+    bool isDue() {
+      return(pending && (int32_t)(millis() - nextAttemptAtMs) >= 0);
+    }
+
+    //Streams the image from the host straight to flash, verified against its MD5 - the device restarts if it succeeds, otherwise it's tried again later:
+    t_httpUpdate_return update() {
+      WiFiClient client;
+
+      #if defined(ESP8266)
+        ESPhttpUpdate.rebootOnUpdate(true);
+        t_httpUpdate_return result = ESPhttpUpdate.update(client, host, port, YY_FIRMWARE_URI);
+      #elif defined(ESP32)
+        httpUpdate.rebootOnUpdate(true);
+        t_httpUpdate_return result = httpUpdate.update(client, host, port, YY_FIRMWARE_URI);
+      #endif
+
+      if(result == HTTP_UPDATE_FAILED && ++attempts < YY_FIRMWARE_MAX_ATTEMPTS) {
+        //the host may just be busy serving other peers:
+        nextAttemptAtMs = millis() + (YY_FIRMWARE_RETRY_MIN_MS << (attempts - 1)) + random(YY_FIRMWARE_RETRY_MIN_MS);
+      }
+      else {
+        pending = false;
+      }
+
+      return(result);
+    }
+};
+
+#endif
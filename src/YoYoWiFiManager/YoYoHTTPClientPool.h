@@ -0,0 +1,192 @@
+#ifndef YoYoHTTPClientPool_h
+#define YoYoHTTPClientPool_h
+
+#define YY_HTTP_CLIENT_HOST_MAX_LENGTH 40
+#define YY_HTTP_CLIENT_IDLE_TIMEOUT_MS 10000
+#define YY_HTTP_RESPONSE_MAX_BYTES 1024
+#define YY_HTTP_RESPONSE_DRAIN_MAX_BYTES 512   //more left unread than this and the connection is closed rather than reused
+
+//Counts what's read through it - so what's left of a response can be drained:
+class YoYoCountingStream : public Stream {
+  private:
+    Stream &stream;
+    size_t count = 0;
+
+  public:
+    YoYoCountingStream(Stream &stream) : stream(stream) {}
+
+    int available() {
+      return(stream.available());
+    }
+
+    int read() {
+      int c = stream.read();
+      if(c >= 0) count++;
+      return(c);
+    }
+
+    int peek() {
+      return(stream.peek());
+    }
+
+    size_t write(uint8_t c) {
+      return(0);
+    }
+
+    void flush() {
+    }
+
+    size_t getCount() {
+      return(count);
+    }
+};
+
+//A small pool of outbound HTTP/1.1 connections, one per host, kept open between calls where the host allows it
+class YoYoHTTPClientPool {
+  public:
+    struct Connection {
+      char host[YY_HTTP_CLIENT_HOST_MAX_LENGTH];
+      HTTPClient http;
+      WiFiClient client;
+      uint32_t lastUsedAtMs;
+      bool inUse;
+    };
+
+  private:
+    Connection *connections = NULL;
+    int size = 0;
+
+    //connections are taken and given back under the lock - and opened and closed outside it:
+    #if defined(ESP32)
+      portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;   //the manager's task and the sketch's may both make requests
+      void lock() { portENTER_CRITICAL(&mux); }
+      void unlock() { portEXIT_CRITICAL(&mux); }
+    #else
+      void lock() {}
+      void unlock() {}
+    #endif
+
+    Connection *find(HTTPClient *http) {
+      Connection *result = NULL;
+
+      for(int n = 0; n < size && !result; ++n) {
+        if(&connections[n].http == http) result = &connections[n];
+      }
+
+      return(result);
+    }
+
+    void close(Connection *connection) {
+      connection -> http.end();
+      connection -> client.stop();
+      connection -> host[0] = '\0';
+    }
+
+  public:
+    void setStorage(Connection *connections, int size) {
+      this -> connections = connections;
+      this -> size = size;
+
+      for(int n = 0; n < size; ++n) {
+        connections[n].host[0] = '\0';
+        connections[n].lastUsedAtMs = 0;
+        connections[n].inUse = false;
+      }
+    }
+
+    //Returns a client ready for a request to server/path - a warm connection to the same host is reused:
+    HTTPClient *acquire(const char *server, const char *path, uint16_t port = 80) {
+      Connection *connection = NULL;
+      bool reused = false;
+
+      if(strlen(server) >= YY_HTTP_CLIENT_HOST_MAX_LENGTH) return(NULL);
+
+      lock();
+      for(int n = 0; n < size && !connection; ++n) {
+        if(!connections[n].inUse && strcmp(connections[n].host, server) == 0) connection = &connections[n];
+      }
+
+      reused = (connection != NULL);
+
+      if(!connection) {
+        //otherwise take over the least recently used:
+        for(int n = 0; n < size; ++n) {
+          if(!connections[n].inUse && (!connection || (int32_t)(connections[n].lastUsedAtMs - connection -> lastUsedAtMs) < 0)) {
+            connection = &connections[n];
+          }
+        }
+      }
+      if(connection) connection -> inUse = true;
+      unlock();
+
+      if(connection) {
+        if(!reused) {
+          if(connection -> host[0] != '\0') close(connection);
+          strcpy(connection -> host, server);
+        }
+        connection -> http.setReuse(true);
+        connection -> http.begin(connection -> client, server, port, path);
+      }
+
+      return(connection ? &connection -> http : NULL);
+    }
+
+    //Reads and throws away what's left of a response once consumed bytes of it have been read - returns false if the connection can't be reused,
+    //as there's too much left, or no telling how much (a chunked response, or one that ends when the connection closes):
+    bool drain(HTTPClient *http, size_t consumed) {
+      int contentLength = http -> getSize();
+      bool complete = false;
+
+      if(contentLength >= 0 && consumed <= (size_t) contentLength && (size_t) contentLength - consumed <= YY_HTTP_RESPONSE_DRAIN_MAX_BYTES) {
+        size_t remaining = contentLength - consumed;
+        uint8_t discard[64];
+        Stream &stream = http -> getStream();
+
+        while(remaining > 0) {
+          size_t n = stream.readBytes(discard, (remaining < sizeof(discard)) ? remaining : sizeof(discard));
+          if(n == 0) break;
+          remaining -= n;
+        }
+        complete = (remaining == 0);
+      }
+
+      return(complete);
+    }
+
+    //Returns the client to the pool - the connection is left open for the next call unless the request failed, or its response wasn't read to the end:
+    void release(HTTPClient *http, bool keepAlive = true) {
+      Connection *connection = find(http);
+
+      if(connection) {
+        if(keepAlive) connection -> http.end();
+        else close(connection);
+
+        lock();
+        connection -> lastUsedAtMs = millis();
+        connection -> inUse = false;
+        unlock();
+      }
+    }
+
+    void evictIdle() {
+      for(int n = 0; n < size; ++n) {
+        Connection *connection = &connections[n];
+        bool idle = false;
+
+        lock();
+        if(!connection -> inUse && connection -> host[0] != '\0' && (millis() - connection -> lastUsedAtMs) > YY_HTTP_CLIENT_IDLE_TIMEOUT_MS) {
+          connection -> inUse = idle = true;
+        }
+        unlock();
+
+        if(idle) {
+          close(connection);
+          lock();
+          connection -> inUse = false;
+          unlock();
+        }
+      }
+    }
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef YoYoIntentQueue_h
+#define YoYoIntentQueue_h
+
+#include <atomic>
+
+#define YY_INTENT_MAX_BYTES YY_BROADCAST_MAX_BYTES
+
+typedef enum {
+  YY_INTENT_CREDENTIALS,          //save the network and connect to it
+  YY_INTENT_RECEIVED,             //a broadcast from a peer - to be applied here and passed on
+  YY_INTENT_BROADCAST,            //a message already applied here - to be passed on
+  YY_INTENT_CONNECT,              //from the sketch - with or without a network to add
+  YY_INTENT_END,
+  YY_INTENT_DISTRIBUTE_FIRMWARE,
+  YY_INTENT_SYNC_ASSETS
+} yy_intent_type_t;
+
+typedef struct {
+  yy_intent_type_t type;
+  int route;
+  IPAddress sender;
+  size_t length;
+  char body[YY_INTENT_MAX_BYTES];    //the message serialised as MessagePack
+} yy_intent_t;
+
+//A bounded lock-free queue of intents - pushed by request handlers (on any task) and applied by loop().
+//Each cell carries a sequence number that says whose turn it is (after Vyukov's bounded MPMC queue) - with a single consumer
+class YoYoIntentQueue {
+  public:
+    typedef struct {
+      std::atomic<uint32_t> sequence;
+      yy_intent_t intent;
+    } cell_t;
+
+  private:
+    cell_t *cells = NULL;
+    uint32_t mask = 0;
+    std::atomic<uint32_t> pushAt;
+    uint32_t popAt = 0;           //only ever touched by the consumer
+    std::atomic<uint32_t> dropped;
+
+  public:
+    YoYoIntentQueue() : pushAt(0), dropped(0) {}
+
+    //depth must be a power of 2:
+    void setStorage(cell_t *cells, int depth) {
+      this -> cells = cells;
+      mask = depth - 1;
+
+      for(int n = 0; n < depth; ++n) cells[n].sequence.store(n, std::memory_order_relaxed);
+      pushAt.store(0, std::memory_order_relaxed);
+      popAt = 0;
+    }
+
+    //Claims the cell at the back of the queue to be filled and then committed - or returns NULL (and counts a drop) if full:
+    yy_intent_t *reserve(uint32_t *position) {
+      cell_t *cell = NULL;
+      uint32_t at = pushAt.load(std::memory_order_relaxed);
+
+      while(cells && !cell) {
+        cell_t *candidate = &cells[at & mask];
+        int32_t difference = (int32_t) (candidate -> sequence.load(std::memory_order_acquire) - at);
+
+        if(difference == 0) {
+          //the cell is free - take it unless another producer got there first:
+          if(pushAt.compare_exchange_weak(at, at + 1, std::memory_order_relaxed)) cell = candidate;
+        }
+        else if(difference < 0) {
+          break;  //full
+        }
+        else {
+          at = pushAt.load(std::memory_order_relaxed);
+        }
+      }
+
+      if(cell) *position = at;
+      else dropped.fetch_add(1, std::memory_order_relaxed);
+
+      return(cell ? &cell -> intent : NULL);
+    }
+
+    //Hands a filled cell to the consumer:
+    void commit(uint32_t position) {
+      cells[position & mask].sequence.store(position + 1, std::memory_order_release);
+    }
+
+    //The intent at the front of the queue once committed - or NULL:
+    yy_intent_t *front() {
+      yy_intent_t *result = NULL;
+
+      if(cells) {
+        cell_t *cell = &cells[popAt & mask];
+        if(cell -> sequence.load(std::memory_order_acquire) == popAt + 1) result = &cell -> intent;
+      }
+
+      return(result);
+    }
+
+    //Gives the front cell back to the producers:
+    void pop() {
+      cells[popAt & mask].sequence.store(popAt + mask + 1, std::memory_order_release);
+      popAt++;
+    }
+
+    uint32_t getDropped() {
+      return(dropped.load(std::memory_order_relaxed));
+    }
+};
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef YoYoJsonArena_h
+#define YoYoJsonArena_h
+
+#define YY_JSON_ARENA_ALIGNMENT 8
+
+//Preallocated memory for the JSON documents of a single request - handed out from the top and given back in reverse order
+class YoYoJsonArena {
+  private:
+    uint8_t *memory = NULL;
+    size_t size = 0;
+    size_t used = 0;
+    size_t highWater = 0;
+    uint32_t overflows = 0;
+
+    //ahead of each block - so the top block can be given back:
+    typedef struct {
+      size_t start;
+      size_t end;
+    } header_t;
+
+    static size_t align(size_t size) {
+      return((size + YY_JSON_ARENA_ALIGNMENT - 1) & ~(size_t) (YY_JSON_ARENA_ALIGNMENT - 1));
+    }
+
+  public:
+    bool inUse = false;
+
+    //memory must be aligned to YY_JSON_ARENA_ALIGNMENT:
+    void setStorage(uint8_t *memory, size_t size) {
+      this -> memory = memory;
+      this -> size = size;
+      used = 0;
+    }
+
+    void *allocate(size_t bytes) {
+      void *result = NULL;
+      size_t start = used;
+      size_t end = start + align(sizeof(header_t)) + align(bytes);
+
+      if(end <= size) {
+        header_t *header = (header_t *) &memory[start];
+        header -> start = start;
+        header -> end = end;
+
+        used = end;
+        if(used > highWater) highWater = used;
+
+        result = &memory[start + align(sizeof(header_t))];
+      }
+      else overflows++;
+
+      return(result);
+    }
+
+    void deallocate(void *pointer) {
+      if(pointer) {
+        header_t *header = (header_t *) ((uint8_t *) pointer - align(sizeof(header_t)));
+
+        //documents are destroyed in the reverse order they were made - anything else is reclaimed by reset():
+        if(header -> end == used) used = header -> start;
+      }
+    }
+
+    bool contains(void *pointer) {
+      return((uint8_t *) pointer >= memory && (uint8_t *) pointer < memory + size);
+    }
+
+    void reset() {
+      used = 0;
+    }
+
+    size_t getHighWater() {
+      return(highWater);
+    }
+
+    uint32_t getOverflows() {
+      return(overflows);
+    }
+};
+
+//An ArduinoJson allocator that takes its memory from an arena - or the heap, outside of a request or if the arena is full
+struct YoYoArenaAllocator {
+  YoYoJsonArena *arena;
+
+  YoYoArenaAllocator(YoYoJsonArena *arena = NULL) : arena(arena) {}
+
+  void *allocate(size_t size) {
+    void *result = arena ? arena -> allocate(size) : NULL;
+
+    return(result ? result : malloc(size));
+  }
+
+  void deallocate(void *pointer) {
+    if(arena && arena -> contains(pointer)) arena -> deallocate(pointer);
+    else free(pointer);
+  }
+
+  void *reallocate(void *pointer, size_t size) {
+    //an arena's blocks can't grow or shrink in place:
+    return((arena && arena -> contains(pointer)) ? NULL : realloc(pointer, size));
+  }
+};
+
+typedef BasicJsonDocument<YoYoArenaAllocator> YoYoArenaJsonDocument;
+
+//A fixed set of arenas - one per request in progress, and requests are handled one at a time
+class YoYoJsonArenaPool {
+  private:
+    YoYoJsonArena *arenas = NULL;
+    int arenaCount = 0;
+    int inUse = 0;
+    int maxInUse = 0;
+    uint32_t exhausted = 0;
+
+  public:
+    //memory holds count arenas of size bytes each:
+    void setStorage(YoYoJsonArena *arenas, int count, uint8_t *memory, size_t size) {
+      this -> arenas = arenas;
+      arenaCount = count;
+
+      for(int n = 0; n < count; ++n) arenas[n].setStorage(&memory[n * size], size);
+    }
+
+    //Returns NULL if every arena is in use:
+    YoYoJsonArena *acquire() {
+      YoYoJsonArena *result = NULL;
+
+      for(int n = 0; n < arenaCount && !result; ++n) {
+        if(!arenas[n].inUse) result = &arenas[n];
+      }
+
+      if(result) {
+        result -> inUse = true;
+        result -> reset();
+        if(++inUse > maxInUse) maxInUse = inUse;
+      }
+      else exhausted++;
+
+      return(result);
+    }
+
+    void release(YoYoJsonArena *arena) {
+      if(arena && arena -> inUse) {
+        arena -> inUse = false;
+        inUse--;
+      }
+    }
+
+    //The most any one request has used:
+    size_t getHighWaterBytes() {
+      size_t result = 0;
+
+      for(int n = 0; n < arenaCount; ++n) {
+        if(arenas[n].getHighWater() > result) result = arenas[n].getHighWater();
+      }
+
+      return(result);
+    }
+
+    //Documents that didn't fit in their arena - and went to the heap instead:
+    uint32_t getOverflowCount() {
+      uint32_t result = 0;
+
+      for(int n = 0; n < arenaCount; ++n) result += arenas[n].getOverflows();
+
+      return(result);
+    }
+
+    int getHighWaterCount() {
+      return(maxInUse);
+    }
+
+    uint32_t getExhaustedCount() {
+      return(exhausted);
+    }
+};
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef YoYoLog_h
+#define YoYoLog_h
+
+#include "Arduino.h"
+#include <stdarg.h>
+
+#define YY_LOG_NONE 0
+#define YY_LOG_ERROR 1
+#define YY_LOG_WARN 2
+#define YY_LOG_INFO 3
+#define YY_LOG_DEBUG 4
+
+//Messages below this level aren't compiled in - set it with a build flag (-DYY_LOG_LEVEL=YY_LOG_WARN, say) so the library sees it too:
+#ifndef YY_LOG_LEVEL
+  #define YY_LOG_LEVEL YY_LOG_INFO
+#endif
+
+//Retained messages are also written to Serial - unless this is 0, or turned off with setSerial(false):
+#ifndef YY_LOG_SERIAL
+  #define YY_LOG_SERIAL 1
+#endif
+
+#define YY_LOGS_URI "/yoyo/logs"
+#define YY_LOG_LINE_MAX_BYTES 128
+
+//The most recent log messages - kept in a fixed-size ring, the oldest overwritten first.
+//Until the ring is given its storage, or if it's given none, messages are only written to Serial
+class YoYoLogBuffer {
+  private:
+    char *buffer = NULL;
+    size_t size = 0;
+    size_t head = 0;          //where the next character goes
+    size_t count = 0;
+    uint32_t written = 0;     //characters ever written - so a reader can tell what has been overwritten
+    uint32_t dropped = 0;     //messages overwritten
+    bool serial = YY_LOG_SERIAL;
+
+    //requests are handled on another task:
+    #if defined(ESP32)
+      portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+      void lock() { portENTER_CRITICAL(&mux); }
+      void unlock() { portEXIT_CRITICAL(&mux); }
+    #else
+      void lock() {}
+      void unlock() {}
+    #endif
+
+    void write(const char *line, size_t length) {
+      lock();
+
+      for(size_t n = 0; n < length && size > 0; ++n) {
+        if(count == size && buffer[head] == '\n') dropped++;
+        buffer[head] = line[n];
+        head = (head + 1) % size;
+        if(count < size) count++;
+        written++;
+      }
+
+      unlock();
+    }
+
+  public:
+    void setStorage(char *buffer, size_t size) {
+      lock();
+      this -> buffer = buffer;
+      this -> size = size;
+      head = 0;
+      count = 0;
+      written = 0;
+      unlock();
+    }
+
+    void log(char level, const char *format, ...) {
+      char line[YY_LOG_LINE_MAX_BYTES];
+      int length = snprintf(line, sizeof(line), "%u %c ", (unsigned int) millis(), level);
+
+      va_list args;
+      va_start(args, format);
+      vsnprintf(&line[length], sizeof(line) - length, format, args);
+      va_end(args);
+
+      length = strlen(line);
+      if(length == sizeof(line) - 1) line[length - 1] = '\n';   //cut short
+      else if(length > 0 && line[length - 1] != '\n') line[length++] = '\n';
+      line[length] = '\0';
+
+      write(line, length);
+      if(serial) Serial.print(line);
+    }
+
+    //Oldest first - starting from the first whole message. Requests print it on another task, so only a 64 byte chunk is copied at a time
+    //under the lock, and printed outside it - anything overwritten in between is skipped up to the next whole message:
+    void print(Print &out) {
+      char chunk[64];
+
+      lock();
+      uint32_t end = written;                 //what's logged while printing is left for next time
+      uint32_t from = written - count;
+      bool skipping = (count == size);        //the oldest message may have lost its start
+      unlock();
+
+      while((int32_t) (end - from) > 0) {
+        size_t length = 0;
+
+        lock();
+        if((int32_t) (from - (written - count)) < 0) {
+          from = written - count;
+          skipping = true;
+        }
+        while((int32_t) (end - from) > 0 && length < sizeof(chunk)) {
+          chunk[length++] = buffer[(head + size - (written - from)) % size];
+          from++;
+        }
+        unlock();
+
+        size_t start = 0;
+        if(skipping) {
+          while(start < length && chunk[start] != '\n') start++;
+          if(start < length) {
+            start++;
+            skipping = false;
+          }
+        }
+        if(start < length) out.write((uint8_t *) &chunk[start], length - start);
+      }
+    }
+
+    void setSerial(bool serial) {
+      this -> serial = serial;
+    }
+
+    uint32_t getDropped() {
+      return(dropped);
+    }
+};
+
+//The one log shared by the manager and the settings:
+inline YoYoLogBuffer &yyLog() {
+  static YoYoLogBuffer log;
+  return(log);
+}
+
+#if YY_LOG_LEVEL >= YY_LOG_ERROR
+  #define YY_LOGE(format, ...) yyLog().log('E', format, ##__VA_ARGS__)
+#else
+  #define YY_LOGE(format, ...)
+#endif
+
+#if YY_LOG_LEVEL >= YY_LOG_WARN
+  #define YY_LOGW(format, ...) yyLog().log('W', format, ##__VA_ARGS__)
+#else
+  #define YY_LOGW(format, ...)
+#endif
+
+#if YY_LOG_LEVEL >= YY_LOG_INFO
+  #define YY_LOGI(format, ...) yyLog().log('I', format, ##__VA_ARGS__)
+#else
+  #define YY_LOGI(format, ...)
+#endif
+
+#if YY_LOG_LEVEL >= YY_LOG_DEBUG
+  #define YY_LOGD(format, ...) yyLog().log('D', format, ##__VA_ARGS__)
+#else
+  #define YY_LOGD(format, ...)
+#endif
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef YoYoManifest_h
+#define YoYoManifest_h
+
+#include <MD5Builder.h>
+#include <memory>
+
+#define YY_MANIFEST_STEP_BYTES 4096          //hashed each loop() while the manifest is being built
+
+//{"/index.html": "<md5>", ...} for every file but the firmware image and any upload in progress.
+//Hashing every file is slow - so it's built a slice at a time from loop(), and only once a file has changed.
+//Requests read it on the web server's task - so each finished manifest is published whole, and a request keeps its copy alive
+class YoYoManifest {
+  public:
+    typedef std::shared_ptr<const String> json_t;
+
+  private:
+    json_t json;
+    uint32_t generation = 0;
+
+    #if defined(ESP32)
+      portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+      void lock() { portENTER_CRITICAL(&mux); }
+      void unlock() { portEXIT_CRITICAL(&mux); }
+    #else
+      void lock() {}
+      void unlock() {}
+    #endif
+
+    //being built:
+    bool building = false;
+    uint32_t buildingGeneration = 0;
+    String next;
+    #if defined(ESP8266)
+      Dir dir;
+    #elif defined(ESP32)
+      File root;
+    #endif
+    File file;
+    String path;
+    MD5Builder md5;
+
+    static bool isExcluded(const String &path, const char *excludedPath) {
+      return(path.equals(YY_UPLOAD_TEMP_PATH) || path.equals(YY_FIRMWARE_PATH) || (excludedPath && path.equals(excludedPath)));
+    }
+
+    void start(uint32_t generation) {
+      if(file) file.close();
+
+      #if defined(ESP8266)
+        dir = SPIFFS.openDir("/");
+      #elif defined(ESP32)
+        if(root) root.close();
+        root = SPIFFS.open("/");
+      #endif
+
+      next = "{";
+      buildingGeneration = generation;
+      building = true;
+    }
+
+    //Opens the next file to be hashed - returns false once there are none left:
+    bool openNext(const char *excludedPath) {
+      #if defined(ESP8266)
+        while(!file && dir.next()) {
+          path = dir.fileName();
+          if(!path.startsWith("/")) path = "/" + path;
+          if(!isExcluded(path, excludedPath)) file = dir.openFile("r");
+        }
+      #elif defined(ESP32)
+        while(!file && root) {
+          File candidate = root.openNextFile();
+          if(!candidate) break;
+
+          path = candidate.name();
+          if(!path.startsWith("/")) path = "/" + path;
+          if(!isExcluded(path, excludedPath)) file = candidate;
+          else candidate.close();
+        }
+      #endif
+
+      if(file) md5.begin();
+
+      return((bool) file);
+    }
+
+    void add() {
+      md5.calculate();
+
+      if(next.length() > 1) next += ",";
+      next += "\"";
+      for(size_t n = 0; n < path.length(); ++n) {
+        if(path[n] == '"' || path[n] == '\\') next += '\\';
+        next += path[n];
+      }
+      next += "\":\"";
+      next += md5.toString();
+      next += "\"";
+
+      file.close();
+    }
+
+    void finish() {
+      next += "}";
+      json_t finished = std::make_shared<const String>(next);
+      next = "";
+
+      //the one it replaces is freed by whichever of us lets go of it last:
+      lock();
+      json.swap(finished);
+      generation = buildingGeneration;
+      unlock();
+
+      building = false;
+
+      #if defined(ESP32)
+        root.close();
+      #endif
+    }
+
+  public:
+    bool isReady(uint32_t generation) {
+      return(get(generation) != nullptr);
+    }
+
+    //The manifest for generation - or nullptr until it's ready:
+    json_t get(uint32_t generation) {
+      json_t result;
+
+      lock();
+      if(json && this -> generation == generation) result = json;
+      unlock();
+
+      return(result);
+    }
+
+    //Hashes the next YY_MANIFEST_STEP_BYTES of the file system for the manifest of generation - starting again if it has moved on:
+    void update(uint32_t generation, const char *excludedPath = NULL) {
+      if(isReady(generation)) return;
+      if(!building || buildingGeneration != generation) start(generation);
+
+      size_t budget = YY_MANIFEST_STEP_BYTES;
+
+      while(building && budget > 0) {
+        if(!file && !openNext(excludedPath)) {
+          finish();
+        }
+        else {
+          size_t n = file.available();
+          if(n > budget) n = budget;
+          if(n > 0) md5.addStream(file, n);
+          budget -= n;
+
+          if(file.available() == 0) add();
+        }
+      }
+    }
+
+    //All at once - only where blocking is fine:
+    void build(uint32_t generation, const char *excludedPath = NULL) {
+      while(!isReady(generation)) update(generation, excludedPath);
+    }
+};
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef YoYoMetrics_h
+#define YoYoMetrics_h
+
+#define YY_METRICS_URI "/yoyo/metrics"
+#define YY_HISTOGRAM_BUCKETS 11
+
+//Counts of durations in fixed buckets - from 250us to 30s, and above
+class YoYoHistogram {
+  public:
+    uint32_t counts[YY_HISTOGRAM_BUCKETS + 1];   //not cumulative - the last is everything above the last bound
+    uint32_t count = 0;
+    uint64_t sumUs = 0;
+
+    YoYoHistogram() {
+      memset(counts, 0, sizeof(counts));
+    }
+
+    static uint32_t getBoundUs(int n) {
+      static const uint32_t bounds[YY_HISTOGRAM_BUCKETS] = { 250, 1000, 2500, 10000, 25000, 100000, 250000, 1000000, 2500000, 10000000, 30000000 };
+      return(bounds[n]);
+    }
+
+    void add(uint32_t us) {
+      int n = 0;
+      while(n < YY_HISTOGRAM_BUCKETS && us > getBoundUs(n)) n++;
+
+      counts[n]++;
+      count++;
+      sumUs += us;
+    }
+
+    //In Prometheus text format - labels (if any) are added to every line:
+    void print(Print &out, const char *name, const char *labels = NULL) {
+      static const char *bounds[YY_HISTOGRAM_BUCKETS] = { "0.00025", "0.001", "0.0025", "0.01", "0.025", "0.1", "0.25", "1", "2.5", "10", "30" };
+      const char *separator = labels ? "," : "";
+      const char *open = labels ? "{" : "";
+      const char *close = labels ? "}" : "";
+      if(!labels) labels = "";
+
+      uint32_t cumulative = 0;
+      for(int n = 0; n < YY_HISTOGRAM_BUCKETS; ++n) {
+        cumulative += counts[n];
+        out.printf("%s_bucket{%s%sle=\"%s\"} %u\n", name, labels, separator, bounds[n], (unsigned int) cumulative);
+      }
+      out.printf("%s_bucket{%s%sle=\"+Inf\"} %u\n", name, labels, separator, (unsigned int) count);
+      out.printf("%s_sum%s%s%s %u.%06u\n", name, open, labels, close, (unsigned int) (sumUs / 1000000), (unsigned int) (sumUs % 1000000));
+      out.printf("%s_count%s%s%s %u\n", name, open, labels, close, (unsigned int) count);
+    }
+};
+
+//Counters and histograms kept while running - fixed in size and cheap to update
+class YoYoMetrics {
+  public:
+    YoYoHistogram *routes = NULL;     //indexed by route id
+    int routeCount = 0;
+    YoYoHistogram otherRequests;      //files, the captive portal - and routes beyond routeCount
+
+    YoYoHistogram loop;
+    YoYoHistogram broadcastFanOut;    //from being queued to every peer acknowledging or being given up on
+    YoYoHistogram scan;
+    YoYoHistogram timeToConnected;
+
+    uint32_t captivePortalRequests = 0;
+    uint32_t connects = 0;
+    uint32_t disconnects = 0;
+
+    //sampled:
+    int inFlightRequests[YY_REQUEST_CLASSES];
+    uint32_t shedRequests[YY_REQUEST_CLASSES];
+    int broadcastQueueDepth = 0;
+    int broadcastQueueHighWater = 0;
+    uint32_t freeHeap = 0;
+    uint32_t largestFreeBlock = 0;
+    uint32_t minFreeHeap = UINT32_MAX;
+
+    YoYoMetrics() {
+      memset(inFlightRequests, 0, sizeof(inFlightRequests));
+      memset(shedRequests, 0, sizeof(shedRequests));
+    }
+
+    void setStorage(YoYoHistogram *routes, int routeCount) {
+      this -> routes = routes;
+      this -> routeCount = routeCount;
+    }
+
+    void request(int route, uint32_t us) {
+      if(route >= 0 && route < routeCount) routes[route].add(us);
+      else otherRequests.add(us);
+    }
+
+    //Cheap enough for every loop():
+    void sampleHeap() {
+      #if defined(ESP8266)
+        freeHeap = ESP.getFreeHeap();
+        if(freeHeap < minFreeHeap) minFreeHeap = freeHeap;
+      #elif defined(ESP32)
+        freeHeap = ESP.getFreeHeap();
+        minFreeHeap = ESP.getMinFreeHeap();
+      #endif
+    }
+
+    //Walks the heap - only when asked for:
+    void sampleLargestFreeBlock() {
+      #if defined(ESP8266)
+        largestFreeBlock = ESP.getMaxFreeBlockSize();
+      #elif defined(ESP32)
+        largestFreeBlock = ESP.getMaxAllocHeap();
+      #endif
+    }
+
+    void print(Print &out, YoYoRoutes &routeTable) {
+      static const char *requestClasses[YY_REQUEST_CLASSES] = { "static", "api", "captive", "transfer" };
+      char labels[64];
+
+      out.print("# TYPE yoyo_request_duration_seconds histogram\n");
+      for(int n = 0; n < routeCount; ++n) {
+        if(routes[n].count > 0 && routeTable.getPath(n)) {
+          snprintf(labels, sizeof(labels), "path=\"%s\"", routeTable.getPath(n));
+          routes[n].print(out, "yoyo_request_duration_seconds", labels);
+        }
+      }
+      otherRequests.print(out, "yoyo_request_duration_seconds", "path=\"other\"");
+
+      out.print("# TYPE yoyo_loop_duration_seconds histogram\n");
+      loop.print(out, "yoyo_loop_duration_seconds");
+      out.print("# TYPE yoyo_broadcast_fan_out_seconds histogram\n");
+      broadcastFanOut.print(out, "yoyo_broadcast_fan_out_seconds");
+      out.print("# TYPE yoyo_scan_duration_seconds histogram\n");
+      scan.print(out, "yoyo_scan_duration_seconds");
+      out.print("# TYPE yoyo_time_to_connected_seconds histogram\n");
+      timeToConnected.print(out, "yoyo_time_to_connected_seconds");
+
+      out.printf("# TYPE yoyo_captive_portal_requests_total counter\nyoyo_captive_portal_requests_total %u\n", (unsigned int) captivePortalRequests);
+      out.printf("# TYPE yoyo_connects_total counter\nyoyo_connects_total %u\n", (unsigned int) connects);
+      out.printf("# TYPE yoyo_disconnects_total counter\nyoyo_disconnects_total %u\n", (unsigned int) disconnects);
+
+      out.print("# TYPE yoyo_requests_shed_total counter\n");
+      for(int n = 0; n < YY_REQUEST_CLASSES; ++n) out.printf("yoyo_requests_shed_total{class=\"%s\"} %u\n", requestClasses[n], (unsigned int) shedRequests[n]);
+      out.print("# TYPE yoyo_requests_in_flight gauge\n");
+      for(int n = 0; n < YY_REQUEST_CLASSES; ++n) out.printf("yoyo_requests_in_flight{class=\"%s\"} %i\n", requestClasses[n], inFlightRequests[n]);
+
+      out.printf("# TYPE yoyo_broadcast_queue_depth gauge\nyoyo_broadcast_queue_depth %i\n", broadcastQueueDepth);
+      out.printf("# TYPE yoyo_broadcast_queue_high_water gauge\nyoyo_broadcast_queue_high_water %i\n", broadcastQueueHighWater);
+      out.printf("# TYPE yoyo_free_heap_bytes gauge\nyoyo_free_heap_bytes %u\n", (unsigned int) freeHeap);
+      out.printf("# TYPE yoyo_largest_free_block_bytes gauge\nyoyo_largest_free_block_bytes %u\n", (unsigned int) largestFreeBlock);
+      out.printf("# TYPE yoyo_min_free_heap_bytes gauge\nyoyo_min_free_heap_bytes %u\n", (unsigned int) minFreeHeap);
+    }
+};
+
+#endif
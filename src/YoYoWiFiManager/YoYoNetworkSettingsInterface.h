@@ -2,6 +2,14 @@
 #define YoYoNetworkSettingsInterface_h
 
 class YoYoNetworkSettingsInterface {
+  protected:
+    uint32_t generation = 0;
+
+    //Implementations call this on any change to the networks - so responses made from them are refreshed:
+    void changed() {
+      generation++;
+    }
+
   public:
     virtual int getNumberOfNetworkCredentials() = 0;
     virtual bool addNetwork(const char *ssid, const char *password, bool force = false, bool autosave = true) = 0;
@@ -20,6 +28,10 @@ class YoYoNetworkSettingsInterface {
     bool hasNetworkCredentials() {
       return(getNumberOfNetworkCredentials() > 0);
     }
+
+    uint32_t getGeneration() {
+      return(generation);
+    }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef YoYoResponseCache_h
+#define YoYoResponseCache_h
+
+//Serialised responses kept by route - each is reused until the generation of the data it was made from moves on
+class YoYoResponseCache {
+  public:
+    typedef struct {
+      int route;
+      uint32_t generation;
+      bool valid;
+      String body;
+    } entry_t;
+
+  private:
+    entry_t *entries = NULL;
+    int size = 0;
+    int next = 0;     //the entry to be replaced when none is free
+
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+
+  public:
+    //A size of 0 disables the cache:
+    void setStorage(entry_t *entries, int size) {
+      this -> entries = entries;
+      this -> size = size;
+
+      for(int n = 0; n < size; ++n) entries[n].valid = false;
+    }
+
+    bool isEnabled() {
+      return(size > 0);
+    }
+
+    //Returns the response for route if it was made from this generation - or NULL:
+    String *get(int route, uint32_t generation) {
+      String *result = NULL;
+
+      for(int n = 0; n < size && !result; ++n) {
+        if(entries[n].valid && entries[n].route == route && entries[n].generation == generation) result = &entries[n].body;
+      }
+
+      if(result) hits++;
+      else misses++;
+
+      return(result);
+    }
+
+    String *put(int route, uint32_t generation, const String &body) {
+      int n = 0;
+
+      //replace the route's previous response - or take a free entry, or the oldest:
+      while(n < size && !(entries[n].valid && entries[n].route == route)) n++;
+      if(n == size) {
+        n = 0;
+        while(n < size && entries[n].valid) n++;
+      }
+      if(n == size) {
+        n = next;
+        next = (next + 1) % size;
+      }
+
+      entries[n].route = route;
+      entries[n].generation = generation;
+      entries[n].body = body;   //reuses the entry's buffer where it's big enough
+      entries[n].valid = true;
+
+      return(&entries[n].body);
+    }
+
+    uint32_t getHits() {
+      return(hits);
+    }
+
+    uint32_t getMisses() {
+      return(misses);
+    }
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef YoYoRoutes_h
+#define YoYoRoutes_h
+
+#define YY_ROUTE_NOT_FOUND -1
+#define YY_ROUTE_METHOD_NOT_ALLOWED -2
+
+//A fixed-size table of endpoints kept sorted by path - so a request is matched with a single binary search
+class YoYoRoutes {
+  public:
+    typedef bool (*routeCallbackPtr)(int, JsonVariant);
+
+    typedef struct {
+      const char *path;
+      WebRequestMethodComposite methods;
+      routeCallbackPtr handler;
+    } route_t;
+
+  private:
+    route_t *routes = NULL;       //indexed by route id - in the order they were added
+    uint8_t *sorted = NULL;       //route ids ordered by path
+    int size = 0;
+    int count = 0;
+
+    //The first position in sorted with a path not less than path:
+    int lowerBound(const char *path) {
+      int low = 0;
+      int high = count;
+
+      while(low < high) {
+        int mid = (low + high) / 2;
+        if(strcmp(routes[sorted[mid]].path, path) < 0) low = mid + 1;
+        else high = mid;
+      }
+
+      return(low);
+    }
+
+  public:
+    //Room for size routes - at most 256, as their ids are sorted as bytes:
+    void setStorage(route_t *routes, uint8_t *sorted, int size) {
+      this -> routes = routes;
+      this -> sorted = sorted;
+      this -> size = size;
+      count = 0;
+    }
+
+    //NB path is not copied - it must remain valid (a string literal, for example)
+    int add(const char *path, WebRequestMethodComposite methods, routeCallbackPtr handler = NULL) {
+      int id = YY_ROUTE_NOT_FOUND;
+
+      if(path && count < size) {
+        id = count;
+        routes[id].path = path;
+        routes[id].methods = methods;
+        routes[id].handler = handler;
+
+        int position = lowerBound(path);
+        memmove(&sorted[position + 1], &sorted[position], count - position);
+        sorted[position] = id;
+        count++;
+      }
+
+      return(id);
+    }
+
+    //Returns the id of the route for path and method - or YY_ROUTE_NOT_FOUND, or YY_ROUTE_METHOD_NOT_ALLOWED if the path is known but not for this method:
+    int find(const char *path, WebRequestMethodComposite method) {
+      int result = YY_ROUTE_NOT_FOUND;
+
+      for(int n = lowerBound(path); n < count && result < 0 && strcmp(routes[sorted[n]].path, path) == 0; ++n) {
+        result = (routes[sorted[n]].methods & method) ? sorted[n] : YY_ROUTE_METHOD_NOT_ALLOWED;
+      }
+
+      return(result);
+    }
+
+    const char *getPath(int id) {
+      return((id >= 0 && id < count) ? routes[id].path : NULL);
+    }
+
+    routeCallbackPtr getHandler(int id) {
+      return((id >= 0 && id < count) ? routes[id].handler : NULL);
+    }
+};
+
+#endif
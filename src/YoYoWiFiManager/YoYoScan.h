@@ -0,0 +1,152 @@
+#ifndef YoYoScan_h
+#define YoYoScan_h
+
+#include <atomic>
+
+#define YY_SCAN_RESULTS_MAX 16
+#define YY_SCAN_SSID_BYTES 33             //32 and the terminator
+
+typedef struct {
+  char ssid[YY_SCAN_SSID_BYTES];
+  uint8_t bssid[6];
+  int32_t rssi;
+} yy_network_t;
+
+//The one owner of the WiFi scan. loop() runs every scan in the background and copies its results here as soon as it finishes -
+//before WiFiMulti can start another or delete them. Everything else (the peer election, /yoyo/networks, matching an SSID) reads the copy.
+//NB the ESP8266 can only scan in the background while ESPAsyncWebServer is running > https://github.com/me-no-dev/ESPAsyncWebServer#scanning-for-available-wifi-networks
+class YoYoScan {
+  private:
+    yy_network_t networks[YY_SCAN_RESULTS_MAX];
+    int count = 0;
+    uint32_t generation = 0;      //moves on with each set of results
+    bool complete = false;
+    uint32_t completedAtMs = 0;
+    uint32_t durationMs = 0;
+
+    bool running = false;
+    uint32_t startedAtMs = 0;
+    std::atomic<bool> requested;
+
+    //requests read the results on the web server's task:
+    #if defined(ESP32)
+      portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+      void lock() { portENTER_CRITICAL(&mux); }
+      void unlock() { portEXIT_CRITICAL(&mux); }
+    #else
+      void lock() {}
+      void unlock() {}
+    #endif
+
+    //Swaps in a whole set of results at once - so a request never sees half of one and half of another:
+    void collect(int found) {
+      yy_network_t results[YY_SCAN_RESULTS_MAX];
+      int n = 0;
+
+      for(int i = 0; i < found && n < YY_SCAN_RESULTS_MAX; ++i) {
+        String ssid = WiFi.SSID(i);
+
+        if(ssid.length() < sizeof(results[n].ssid)) {
+          strcpy(results[n].ssid, ssid.c_str());
+          memcpy(results[n].bssid, WiFi.BSSID(i), sizeof(results[n].bssid));
+          results[n].rssi = WiFi.RSSI(i);
+          n++;
+        }
+      }
+
+      lock();
+      memcpy(networks, results, n * sizeof(yy_network_t));
+      count = n;
+      generation++;
+      unlock();
+    }
+
+  public:
+    YoYoScan() : requested(false) {}
+
+    //From any task - loop() starts a scan unless the last one is recent enough:
+    void request() {
+      requested.store(true);
+    }
+
+    //loop() - starts a scan now, or joins the one running. Returns false if one can't be started:
+    bool start() {
+      if(!running) {
+        running = (WiFi.scanNetworks(true, false) == WIFI_SCAN_RUNNING);
+        if(running) startedAtMs = millis();
+      }
+      requested.store(false);
+
+      return(running);
+    }
+
+    //loop() - starts a scan that has been asked for, unless the last finished less than minIntervalMs ago, and collects one that has finished.
+    //Returns true once there are new results:
+    bool update(uint32_t minIntervalMs) {
+      bool result = false;
+
+      if(requested.load() && !running) {
+        if(!complete || (millis() - completedAtMs) > minIntervalMs) start();
+        else requested.store(false);
+      }
+
+      if(running) {
+        int found = WiFi.scanComplete();
+
+        if(found != WIFI_SCAN_RUNNING) {
+          running = false;
+
+          if(found >= 0) {
+            collect(found);
+            complete = true;
+            completedAtMs = millis();
+            durationMs = completedAtMs - startedAtMs;
+            result = true;
+          }
+          WiFi.scanDelete();
+        }
+      }
+
+      return(result);
+    }
+
+    bool isRunning() {
+      return(running);
+    }
+
+    //Copies the nth network of the results of generation - returns false if there's no such network, or newer results have replaced them:
+    bool get(int n, yy_network_t *network, uint32_t generation) {
+      bool result = false;
+
+      lock();
+      if(this -> generation == generation && n >= 0 && n < count) {
+        *network = networks[n];
+        result = true;
+      }
+      unlock();
+
+      return(result);
+    }
+
+    int getCount() {
+      lock();
+      int result = count;
+      unlock();
+
+      return(result);
+    }
+
+    uint32_t getGeneration() {
+      lock();
+      uint32_t result = generation;
+      unlock();
+
+      return(result);
+    }
+
+    uint32_t getDurationMs() {
+      return(durationMs);
+    }
+};
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef YoYoScheduler_h
+#define YoYoScheduler_h
+
+#define YY_SCHEDULER_MAX_TASKS 8
+#define YY_SCHEDULER_IDLE_MS 1000            //reported as the time to the next deadline when nothing is scheduled
+
+typedef void (*yy_scheduled_t)(void *context);
+
+//Work that's due at a time - every so often, or once - run from loop() rather than each piece comparing millis() for itself.
+//Deadlines are compared as differences, so they hold across millis() wrapping round after 49 days
+class YoYoScheduler {
+  public:
+    typedef struct {
+      const char *name;
+      yy_scheduled_t callback;
+      void *context;
+      uint32_t intervalMs;        //0 runs once each time it's started
+      uint32_t dueAtMs;
+      bool armed;
+
+      uint32_t runs;
+      uint64_t runUs;
+      uint32_t maxRunUs;
+      uint64_t lateMs;            //after its deadline - by however long loop() took to come round
+      uint32_t maxLateMs;
+    } task_t;
+
+  private:
+    task_t tasks[YY_SCHEDULER_MAX_TASKS];
+    int count = 0;
+
+    static bool isDue(uint32_t atMs, uint32_t nowMs) {
+      return((int32_t)(nowMs - atMs) >= 0);
+    }
+
+  public:
+    //Returns the task's id - or -1 if there's no room. Tasks with an interval start straight away, the others once started:
+    int add(const char *name, yy_scheduled_t callback, void *context, uint32_t intervalMs = 0) {
+      int id = -1;
+
+      if(count < YY_SCHEDULER_MAX_TASKS) {
+        id = count++;
+        task_t *task = &tasks[id];
+        memset(task, 0, sizeof(task_t));
+        task -> name = name;
+        task -> callback = callback;
+        task -> context = context;
+        task -> intervalMs = intervalMs;
+        task -> dueAtMs = millis() + intervalMs;
+        task -> armed = (intervalMs > 0);
+      }
+
+      return(id);
+    }
+
+    //(Re)arms a task to run after delayMs - 0 runs it on the next run():
+    void start(int id, uint32_t delayMs) {
+      if(id >= 0 && id < count) {
+        tasks[id].dueAtMs = millis() + delayMs;
+        tasks[id].armed = true;
+      }
+    }
+
+    void stop(int id) {
+      if(id >= 0 && id < count) tasks[id].armed = false;
+    }
+
+    bool isArmed(int id) {
+      return(id >= 0 && id < count && tasks[id].armed);
+    }
+
+    //Runs every task that's due - a task that has fallen behind runs once and skips the deadlines it missed:
+    void run() {
+      for(int n = 0; n < count; ++n) {
+        task_t *task = &tasks[n];
+        uint32_t nowMs = millis();
+
+        if(task -> armed && isDue(task -> dueAtMs, nowMs)) {
+          uint32_t lateMs = nowMs - task -> dueAtMs;
+
+          //before the callback - which may start or stop the task itself:
+          if(task -> intervalMs > 0) {
+            task -> dueAtMs += task -> intervalMs;
+            if(isDue(task -> dueAtMs, nowMs)) task -> dueAtMs = nowMs + task -> intervalMs;
+          }
+          else task -> armed = false;
+
+          uint32_t startedAtUs = micros();
+          task -> callback(task -> context);
+          uint32_t runUs = micros() - startedAtUs;
+
+          task -> runs++;
+          task -> runUs += runUs;
+          if(runUs > task -> maxRunUs) task -> maxRunUs = runUs;
+          task -> lateMs += lateMs;
+          if(lateMs > task -> maxLateMs) task -> maxLateMs = lateMs;
+        }
+      }
+    }
+
+    //How long loop() could sleep before something is due - 0 if something already is:
+    uint32_t getMsUntilNext() {
+      uint32_t result = YY_SCHEDULER_IDLE_MS;
+      uint32_t nowMs = millis();
+
+      for(int n = 0; n < count; ++n) {
+        if(tasks[n].armed) {
+          uint32_t untilMs = isDue(tasks[n].dueAtMs, nowMs) ? 0 : tasks[n].dueAtMs - nowMs;
+          if(untilMs < result) result = untilMs;
+        }
+      }
+
+      return(result);
+    }
+
+    task_t *getTask(int id) {
+      return((id >= 0 && id < count) ? &tasks[id] : NULL);
+    }
+
+    int getTaskCount() {
+      return(count);
+    }
+
+    //In Prometheus text format:
+    void print(Print &out) {
+      out.print("# TYPE yoyo_task_runs_total counter\n");
+      for(int n = 0; n < count; ++n) out.printf("yoyo_task_runs_total{task=\"%s\"} %u\n", tasks[n].name, (unsigned int) tasks[n].runs);
+
+      out.print("# TYPE yoyo_task_run_seconds_total counter\n");
+      for(int n = 0; n < count; ++n) out.printf("yoyo_task_run_seconds_total{task=\"%s\"} %u.%06u\n", tasks[n].name, (unsigned int) (tasks[n].runUs / 1000000), (unsigned int) (tasks[n].runUs % 1000000));
+
+      out.print("# TYPE yoyo_task_run_seconds_max gauge\n");
+      for(int n = 0; n < count; ++n) out.printf("yoyo_task_run_seconds_max{task=\"%s\"} %u.%06u\n", tasks[n].name, (unsigned int) (tasks[n].maxRunUs / 1000000), (unsigned int) (tasks[n].maxRunUs % 1000000));
+
+      out.print("# TYPE yoyo_task_lateness_seconds_total counter\n");
+      for(int n = 0; n < count; ++n) out.printf("yoyo_task_lateness_seconds_total{task=\"%s\"} %u.%03u\n", tasks[n].name, (unsigned int) (tasks[n].lateMs / 1000), (unsigned int) (tasks[n].lateMs % 1000));
+
+      out.print("# TYPE yoyo_task_lateness_seconds_max gauge\n");
+      for(int n = 0; n < count; ++n) out.printf("yoyo_task_lateness_seconds_max{task=\"%s\"} %u.%03u\n", tasks[n].name, (unsigned int) (tasks[n].maxLateMs / 1000), (unsigned int) (tasks[n].maxLateMs % 1000));
+    }
+};
+
+#endif
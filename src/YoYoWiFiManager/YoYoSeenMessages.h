@@ -0,0 +1,51 @@
+#ifndef YoYoSeenMessages_h
+#define YoYoSeenMessages_h
+
+#define YY_SEEN_MESSAGES_WINDOW 16
+
+//A fixed-size window of the most recently seen broadcast message ids - an id is the origin chip id plus a sequence number
+class YoYoSeenMessages {
+  private:
+    struct {
+      uint32_t origin;
+      uint32_t seq;
+    } window[YY_SEEN_MESSAGES_WINDOW];
+    int next = 0;
+    int count = 0;
+    uint32_t duplicates = 0;
+
+  public:
+    bool contains(uint32_t origin, uint32_t seq) {
+      bool result = false;
+
+      for(int n = 0; n < count && !result; ++n) {
+        result = (window[n].origin == origin && window[n].seq == seq);
+      }
+
+      return(result);
+    }
+
+    void add(uint32_t origin, uint32_t seq) {
+      //the oldest id is overwritten once the window is full:
+      window[next].origin = origin;
+      window[next].seq = seq;
+      next = (next + 1) % YY_SEEN_MESSAGES_WINDOW;
+      if(count < YY_SEEN_MESSAGES_WINDOW) count++;
+    }
+
+    //Returns true the first time an id is seen, false (and counts a duplicate) after that:
+    bool check(uint32_t origin, uint32_t seq) {
+      bool result = !contains(origin, seq);
+
+      if(result) add(origin, seq);
+      else duplicates++;
+
+      return(result);
+    }
+
+    uint32_t getDuplicateCount() {
+      return(duplicates);
+    }
+};
+
+#endif
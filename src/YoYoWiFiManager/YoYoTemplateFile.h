@@ -0,0 +1,126 @@
+#ifndef YoYoTemplateFile_h
+#define YoYoTemplateFile_h
+
+#include <functional>
+
+#define YY_TEMPLATE_NAME_MAX_LENGTH 32
+#define YY_TEMPLATE_READ_BYTES 64
+
+//Returns true, with the text to put in its place, if name is a known placeholder:
+typedef std::function<bool(const char *name, String &result)> templateCallbackPtr;
+
+//A file streamed with each known %NAME% replaced - any other text, including a lone or doubled %, is passed through as it is
+class YoYoTemplateFile {
+  private:
+    File file;
+    templateCallbackPtr callback;
+
+    uint8_t input[YY_TEMPLATE_READ_BYTES];
+    size_t inputLength = 0;
+    size_t inputAt = 0;
+
+    String pending;               //waiting to be sent - a substitution, or text that turned out not to be a placeholder
+    size_t pendingAt = 0;
+
+    bool inName = false;          //after a % that may open a placeholder
+    char name[YY_TEMPLATE_NAME_MAX_LENGTH + 1];
+    size_t nameLength = 0;
+
+    int next() {
+      if(inputAt == inputLength) {
+        int n = file ? file.read(input, sizeof(input)) : 0;
+        inputLength = (n > 0) ? n : 0;
+        inputAt = 0;
+      }
+
+      return(inputAt < inputLength ? input[inputAt++] : -1);
+    }
+
+    //Not a placeholder after all - the % and what followed it are sent as they were:
+    void passThrough() {
+      name[nameLength] = '\0';
+      pending = "%";
+      pending += name;
+      nameLength = 0;
+    }
+
+  public:
+    static bool isNameCharacter(int c) {
+      return(isalnum(c) || c == '_');
+    }
+
+    static bool isName(const char *name) {
+      size_t length = strlen(name);
+      bool result = (length > 0 && length <= YY_TEMPLATE_NAME_MAX_LENGTH);
+
+      for(size_t n = 0; n < length && result; ++n) result = isNameCharacter(name[n]);
+
+      return(result);
+    }
+
+    YoYoTemplateFile(File file, templateCallbackPtr callback) : file(file), callback(callback) {
+    }
+
+    ~YoYoTemplateFile() {
+      if(file) file.close();
+    }
+
+    //Fills buffer with up to maxLength bytes - returns 0 at the end of the file:
+    size_t fill(uint8_t *buffer, size_t maxLength) {
+      size_t length = 0;
+
+      while(length < maxLength) {
+        if(pendingAt < pending.length()) {
+          size_t n = min(maxLength - length, pending.length() - pendingAt);
+          memcpy(&buffer[length], pending.c_str() + pendingAt, n);
+          length += n;
+          pendingAt += n;
+          continue;
+        }
+        pending = "";
+        pendingAt = 0;
+
+        int c = next();
+
+        if(c < 0) {
+          if(!inName) break;
+
+          inName = false;
+          passThrough();
+        }
+        else if(inName && c == '%') {
+          String result;
+          name[nameLength] = '\0';
+
+          if(nameLength > 0 && callback(name, result)) {
+            pending = result;
+            inName = false;
+            nameLength = 0;
+          }
+          else {
+            //this % may open the next placeholder:
+            passThrough();
+          }
+        }
+        else if(inName && isNameCharacter(c) && nameLength < YY_TEMPLATE_NAME_MAX_LENGTH) {
+          name[nameLength++] = c;
+        }
+        else if(inName) {
+          inName = false;
+          passThrough();
+          pending += (char) c;
+        }
+        else if(c == '%') {
+          inName = true;
+          nameLength = 0;
+        }
+        else {
+          buffer[length++] = c;
+        }
+      }
+
+      return(length);
+    }
+};
+
+#endif
@@ -0,0 +1,73 @@
+//The default limits against the bundled pages - Examples/Basic asks for six files and four endpoints at once, and a script
+//that's turned away reloads the page (onerror="location.reload()"), so none of it may be shed. Built for each platform's defaults
+
+#include <Arduino.h>
+
+#include "YoYoConfig.h"
+#include "YoYoAdmission.h"
+
+#define PAGE_FILES 6          //bootstrap css and js, jquery, script.js, style.css, the logo
+#define PAGE_ENDPOINTS 4      //credentials, networks, peers, clients
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+  if(!condition) {
+    fprintf(stderr, "FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+int main() {
+  typedef YoYoDefaultConfig Config;
+
+  static YoYoAdmission::entry_t requests[Config::maxStaticRequests + Config::maxApiRequests + Config::maxCaptiveRequests + Config::maxTransferRequests];
+  static int request[64];     //stand-ins for AsyncWebServerRequests - only their addresses are used
+  int next = 0;
+
+  YoYoAdmission admission;
+  admission.setStorage(requests, sizeof(requests) / sizeof(requests[0]));
+  admission.setLimit(YY_REQUEST_STATIC, Config::maxStaticRequests);
+  admission.setLimit(YY_REQUEST_API, Config::maxApiRequests);
+  admission.setLimit(YY_REQUEST_CAPTIVE, Config::maxCaptiveRequests);
+  admission.setLimit(YY_REQUEST_TRANSFER, Config::maxTransferRequests);
+
+  //peers fetching firmware hold their connections throughout:
+  int transfers = 0;
+  while(admission.admit(&request[next], YY_REQUEST_TRANSFER)) {
+    next++;
+    transfers++;
+  }
+  check(transfers == Config::maxTransferRequests, "transfers are limited by their own class");
+
+  //phones probing for the captive portal at the same time:
+  for(int n = 0; n < 10; ++n) {
+    if(admission.admit(&request[next], YY_REQUEST_CAPTIVE)) next++;
+  }
+
+  //the page - its files and endpoints all in flight together, as the browser asks for them:
+  int pageStart = next;
+  check(admission.admit(&request[next++], YY_REQUEST_STATIC), "index.html admitted");
+  admission.end(&request[pageStart]);
+
+  pageStart = next;
+  for(int n = 0; n < PAGE_FILES; ++n) check(admission.admit(&request[next++], YY_REQUEST_STATIC), "a file the page needs admitted");
+  for(int n = 0; n < PAGE_ENDPOINTS; ++n) check(admission.admit(&request[next++], YY_REQUEST_API), "an endpoint the page needs admitted");
+
+  check(admission.getShed(YY_REQUEST_STATIC) == 0 && admission.getShed(YY_REQUEST_API) == 0, "nothing the page needs shed");
+  check(admission.getShed(YY_REQUEST_CAPTIVE) == (uint32_t) (10 - Config::maxCaptiveRequests), "captive probes beyond their limit shed");
+
+  //every slot is given back as each connection closes:
+  for(int n = 0; n < next; ++n) admission.end(&request[n]);
+  check(admission.getInFlight() == 0, "every request given back");
+
+  printf("%s defaults: %i files and %i endpoints in flight beside %i transfers and %i captive probes - %u shed\n",
+    #if defined(ESP8266)
+      "ESP8266",
+    #else
+      "ESP32",
+    #endif
+    PAGE_FILES, PAGE_ENDPOINTS, transfers, Config::maxCaptiveRequests, (unsigned int) (admission.getShed(YY_REQUEST_STATIC) + admission.getShed(YY_REQUEST_API)));
+
+  return(failures == 0 ? 0 : 1);
+}
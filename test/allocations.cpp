@@ -0,0 +1,189 @@
+//The helpers loop() and every request go through - scheduling, admission, routing, metrics, logging, the intent and broadcast
+//queues and the JSON arena - must not touch the heap once each has been given its storage.
+//This drives the helpers, not the manager, which needs a board: its own loop() and handlers still allocate for a pending intent
+//(the document processIntents() decodes it into), a response cache miss (the String it's built in) and, on the ESP32,
+//a printf() of more than 64 bytes - the shim's Print formats on the stack
+
+#include <Arduino.h>
+#include <new>
+
+#include "YoYoLog.h"
+#include "YoYoRoutes.h"
+#include "YoYoAdmission.h"
+#include "YoYoScheduler.h"
+#include "YoYoMetrics.h"
+#include "YoYoSeenMessages.h"
+#include "YoYoBroadcastQueue.h"
+#include "YoYoIntentQueue.h"
+#include "YoYoJsonArena.h"
+
+#define PASSES 1000
+
+static bool counting = false;
+static size_t allocations = 0;
+
+void *operator new(size_t size) {
+  if(counting) allocations++;
+
+  void *result = malloc(size ? size : 1);
+  if(!result) throw std::bad_alloc();
+
+  return(result);
+}
+
+void *operator new[](size_t size) {
+  return(operator new(size));
+}
+
+void operator delete(void *pointer) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+  free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept {
+  free(pointer);
+}
+
+//Counts what's printed - as a response stream would send it:
+class NullPrint : public Print {
+  public:
+    size_t length = 0;
+
+    size_t write(uint8_t /*c*/) {
+      length++;
+      return(1);
+    }
+};
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+  if(!condition) {
+    fprintf(stderr, "FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static int ran = 0;
+
+static void onDue(void * /*context*/) {
+  ran++;
+}
+
+int main() {
+  //storage - as YoYoWiFiManagerT holds it:
+  static YoYoRoutes::route_t routeTable[24];
+  static uint8_t routeOrder[24];
+  static YoYoAdmission::entry_t requests[8];
+  static YoYoHistogram routeHistograms[16];
+  static char logBuffer[1024];
+  static YoYoIntentQueue::cell_t intentCells[4];
+  static yy_broadcast_t broadcasts[8];
+  static yy_peer_delivery_t deliveries[8 * 4];
+  static YoYoJsonArena arenas[1];
+  static uint8_t arenaMemory[4096] __attribute__((aligned(YY_JSON_ARENA_ALIGNMENT)));
+
+  YoYoRoutes routes;
+  YoYoAdmission admission;
+  YoYoScheduler scheduler;
+  YoYoMetrics metrics;
+  YoYoSeenMessages seenMessages;
+  YoYoBroadcastQueue broadcastQueue;
+  YoYoIntentQueue intents;
+  YoYoJsonArenaPool jsonArenas;
+
+  routes.setStorage(routeTable, routeOrder, 24);
+  routes.add("/yoyo/networks", HTTP_GET);
+  routes.add("/yoyo/credentials", HTTP_GET | HTTP_POST);
+  routes.add("/yoyo/broadcast", HTTP_POST);
+
+  admission.setStorage(requests, 8);
+  admission.setLimit(YY_REQUEST_STATIC, 4);
+  admission.setLimit(YY_REQUEST_API, 2);
+  admission.setLimit(YY_REQUEST_CAPTIVE, 2);
+
+  scheduler.add("every_10ms", onDue, NULL, 10);
+  int once = scheduler.add("once", onDue, NULL);
+
+  metrics.setStorage(routeHistograms, 16);
+  yyLog().setStorage(logBuffer, sizeof(logBuffer));
+  intents.setStorage(intentCells, 4);
+  broadcastQueue.setStorage(broadcasts, 8, deliveries, 4);
+  jsonArenas.setStorage(arenas, 1, arenaMemory, sizeof(arenaMemory));
+
+  NullPrint response;
+  int request;          //stands in for an AsyncWebServerRequest - only its address is used
+  bool inArena = true;
+
+  counting = true;
+
+  for(int pass = 0; pass < PASSES; ++pass) {
+    hostMillis() += 3;
+
+    //loop():
+    scheduler.run();
+    if(pass % 100 == 0) scheduler.start(once, 0);
+    metrics.loop.add(250 + pass);
+    metrics.sampleHeap();
+
+    yy_intent_t *intent;
+    while((intent = intents.front()) != NULL) intents.pop();
+
+    yy_broadcast_t *broadcast = broadcastQueue.push();
+    if(broadcast) broadcast -> length = 0;
+    if(broadcastQueue.front()) broadcastQueue.pop();
+
+    //a request:
+    if(admission.admit(&request, YY_REQUEST_API)) {
+      int route = routes.find("/yoyo/credentials", HTTP_POST);
+
+      YoYoJsonArena *arena = jsonArenas.acquire();
+      YoYoArenaAllocator allocator(arena);
+      void *message = allocator.allocate(1024);
+      void *payload = allocator.allocate(1024);
+      inArena = inArena && arena && arena -> contains(message) && arena -> contains(payload);
+      allocator.deallocate(payload);
+      allocator.deallocate(message);
+      jsonArenas.release(arena);
+
+      uint32_t position;
+      intent = intents.reserve(&position);
+      if(intent) {
+        intent -> type = YY_INTENT_CREDENTIALS;
+        intent -> route = route;
+        intent -> length = 0;
+        intents.commit(position);
+      }
+
+      seenMessages.check(1, pass);
+      YY_LOGI("request %i handled", pass);
+      metrics.request(route, 1000 + pass);
+      admission.end(&request);
+    }
+
+    //the monitoring endpoints:
+    if(pass % 100 == 0) {
+      metrics.print(response, routes);
+      scheduler.print(response);
+      yyLog().print(response);
+    }
+  }
+
+  counting = false;
+
+  check(allocations == 0, "heap allocations on the hot paths");
+  check(inArena, "JSON documents outside the arena");
+  check(ran > 0, "scheduled work ran");
+  check(response.length > 0, "monitoring endpoints printed");
+
+  printf("%u heap allocations in %i passes\n", (unsigned int) allocations, PASSES);
+
+  return(failures == 0 ? 0 : 1);
+}
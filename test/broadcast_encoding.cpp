@@ -0,0 +1,79 @@
+//A broadcast as it goes from one device to another - the Vue example's colour, stamped with its origin and sequence number -
+//serialised and parsed as JSON and as MessagePack, for the bytes each puts on air and the time each takes.
+//Built against ArduinoJson itself (not the shim), so only where the library is installed
+
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#define ROUNDS 100000
+#define BODY_MAX_BYTES 512            //YY_BROADCAST_MAX_BYTES - the shim YoYoBroadcastQueue.h needs has its own JsonVariant
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+  if(!condition) {
+    fprintf(stderr, "FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static void makeMessage(JsonDocument &message) {
+  message["path"] = "/yoyo/colour";
+  JsonObject payload = message.createNestedObject("payload");
+  payload["hue"] = 210;
+  payload["red"] = 0;
+  payload["green"] = 127;
+  payload["blue"] = 255;
+  message["origin"] = 3232235777UL;     //a chip id
+  message["seq"] = 42;
+}
+
+static bool isColour(JsonDocument &message) {
+  return(strcmp(message["path"] | "", "/yoyo/colour") == 0 && message["payload"]["hue"] == 210 && message["payload"]["red"] == 0 &&
+          message["payload"]["green"] == 127 && message["payload"]["blue"] == 255 && message["origin"] == 3232235777UL && message["seq"] == 42);
+}
+
+static double nsSince(std::chrono::steady_clock::time_point start) {
+  return(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ROUNDS);
+}
+
+int main() {
+  StaticJsonDocument<BODY_MAX_BYTES> message;
+  char json[BODY_MAX_BYTES];
+  uint8_t msgPack[BODY_MAX_BYTES];
+  size_t jsonBytes = 0;
+  size_t msgPackBytes = 0;
+
+  makeMessage(message);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for(int n = 0; n < ROUNDS; ++n) jsonBytes = serializeJson(message, json, sizeof(json));
+  double jsonSerialiseNs = nsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  for(int n = 0; n < ROUNDS; ++n) msgPackBytes = serializeMsgPack(message, msgPack, sizeof(msgPack));
+  double msgPackSerialiseNs = nsSince(start);
+
+  bool parsed = true;
+
+  start = std::chrono::steady_clock::now();
+  for(int n = 0; n < ROUNDS && parsed; ++n) parsed = (deserializeJson(message, (const char *) json, jsonBytes) == DeserializationError::Ok);
+  double jsonParseNs = nsSince(start);
+  check(parsed && isColour(message), "the JSON parsed back to the same message");
+
+  start = std::chrono::steady_clock::now();
+  for(int n = 0; n < ROUNDS && parsed; ++n) parsed = (deserializeMsgPack(message, (const char *) msgPack, msgPackBytes) == DeserializationError::Ok);
+  double msgPackParseNs = nsSince(start);
+  check(parsed && isColour(message), "the MessagePack parsed back to the same message");
+
+  check(jsonBytes > 0 && msgPackBytes > 0, "both serialised");
+  check(msgPackBytes < jsonBytes, "MessagePack is smaller on air");
+
+  printf("%-12s %6s %14s %10s\n", "", "bytes", "serialise ns", "parse ns");
+  printf("%-12s %6u %14.0f %10.0f\n", "JSON", (unsigned int) jsonBytes, jsonSerialiseNs, jsonParseNs);
+  printf("%-12s %6u %14.0f %10.0f\n", "MessagePack", (unsigned int) msgPackBytes, msgPackSerialiseNs, msgPackParseNs);
+
+  return(failures == 0 ? 0 : 1);
+}
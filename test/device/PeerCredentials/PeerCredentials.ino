@@ -0,0 +1,61 @@
+/*
+    Checks that a network saved on one device is saved on its peers too - flash it to two devices:
+      - device A with PEER_SERVER 1 starts the peer network and, once B has joined, POSTs CHECK_SSID to its own /yoyo/credentials
+      - device B with PEER_SERVER 0 joins it and reports PASS once CHECK_SSID is in its settings - or FAIL after CHECK_TIMEOUT_MS
+    Both start with their saved networks cleared.
+*/
+
+#include <YoYoWiFiManager.h>
+#include <YoYoSettings.h>
+
+#define PEER_SERVER 1
+#define CHECK_SSID "yoyo-peer-check"
+#define CHECK_PASSWORD "peer-check"
+#define CHECK_TIMEOUT_MS 60000
+
+YoYoWiFiManager wifiManager;
+YoYoSettings *settings;
+
+bool posted = false;
+bool reported = false;
+
+void setup() {
+  Serial.begin(115200);
+
+  settings = new YoYoSettings(512);
+  settings -> clearNetworks();
+
+  wifiManager.init(settings);
+  #if PEER_SERVER
+    wifiManager.setPeerElection(true);   //starts the peer network within seconds - B keeps looking for it
+  #endif
+  wifiManager.begin("YoYoMachines", "blinkblink", false);
+}
+
+void loop() {
+  uint8_t status = wifiManager.loop();
+
+  #if PEER_SERVER
+    if(!posted && status == YY_CONNECTED_PEER_SERVER) {
+      WiFiClient client;
+      HTTPClient http;
+
+      http.begin(client, WiFi.softAPIP().toString(), 80, "/yoyo/credentials");
+      http.addHeader("Content-Type", "application/json");
+      int httpResponseCode = http.POST("{\"ssid\":\"" CHECK_SSID "\",\"password\":\"" CHECK_PASSWORD "\"}");
+      http.end();
+
+      Serial.printf("POST /yoyo/credentials: %i\n", httpResponseCode);
+      posted = (httpResponseCode == 200);
+    }
+  #else
+    if(!reported && settings -> getNetwork(CHECK_SSID) >= 0) {
+      Serial.println("PASS - the peer's network was saved here");
+      reported = true;
+    }
+    else if(!reported && millis() > CHECK_TIMEOUT_MS) {
+      Serial.println("FAIL - the peer's network wasn't saved here");
+      reported = true;
+    }
+  #endif
+}
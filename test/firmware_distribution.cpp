@@ -0,0 +1,215 @@
+//Firmware distribution across a simulated peer network. The peer server runs in task mode: the sketch's distributeFirmware()
+//is handed to the manager's task as an intent, which shares the image and announces it. Each peer (a thread of its own) takes the
+//announcement only from the gateway, then fetches the image from a stand-in for the server's /yoyo/firmware - which, like the real one,
+//sends it to a few peers at a time and asks the rest to come back later. Built for the ESP32, against the shim
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <MD5Builder.h>
+#include <HTTPUpdate.h>
+#include <thread>
+#include <vector>
+
+#include "YoYoBroadcastQueue.h"
+#include "YoYoIntentQueue.h"
+#include "YoYoFirmwareUpdate.h"
+
+#define PEERS 6
+#define IMAGE_BYTES (256 * 1024)
+#define CHUNK_BYTES 1436
+#define GIVE_UP_MS (60 * 60 * 1000)
+
+static const IPAddress gateway(192, 168, 4, 1);
+
+static std::atomic<int> failures(0);
+
+static void check(bool condition, const char *what) {
+  if(!condition) {
+    fprintf(stderr, "FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+//The peer server - its request handlers run on one task, modelled by the lock:
+static YoYoFirmwareUpdate server;
+static std::mutex serverTask;
+static int transfers = 0;
+static int mostTransfers = 0;
+static std::atomic<int> turnedAway(0);
+
+//What the announcement carries - as the broadcast's payload would:
+typedef struct {
+  bool received;
+  IPAddress sender;
+  char host[16];
+  uint16_t port;
+  char md5[33];
+} announcement_t;
+
+static announcement_t announcements[PEERS];
+static std::mutex network;
+static std::atomic<int> flashed(0);
+static std::atomic<bool> running(true);
+
+//GET /yoyo/firmware - streams the shared image as sendFirmware() does, and checks it against x-MD5 as the updater does:
+static t_httpUpdate_return standInServer(const char *host, uint16_t port, const char *uri) {
+  IPAddress address;
+  if(!address.fromString(host) || !(address == gateway) || port != 80 || strcmp(uri, YY_FIRMWARE_URI) != 0) return(HTTP_UPDATE_FAILED);
+
+  char md5[33];
+  {
+    std::lock_guard<std::mutex> task(serverTask);
+    if(!server.isShared()) return(HTTP_UPDATE_FAILED);   //404
+
+    if(!server.beginTransfer()) {
+      turnedAway++;
+      return(HTTP_UPDATE_FAILED);                          //503 and Retry-After
+    }
+    if(++transfers > mostTransfers) mostTransfers = transfers;
+    strcpy(md5, server.getMD5());
+  }
+
+  File image = SPIFFS.open(server.getPath(), "r");
+  MD5Builder received;
+  received.begin();
+
+  uint8_t chunk[CHUNK_BYTES];
+  size_t length;
+  while((length = image.readBytes(chunk, sizeof(chunk))) > 0) {
+    received.add(chunk, length);
+    std::this_thread::yield();                             //other peers' transfers carry on meanwhile
+  }
+  image.close();
+  received.calculate();
+
+  //the connection closes:
+  {
+    std::lock_guard<std::mutex> task(serverTask);
+    server.endTransfer();
+    transfers--;
+  }
+
+  return(received.toString().equalsIgnoreCase(md5) ? HTTP_UPDATE_OK : HTTP_UPDATE_FAILED);
+}
+
+static void runPeer(int peer) {
+  YoYoFirmwareUpdate firmwareUpdate;
+  bool done = false;
+
+  while(running && !done) {
+    {
+      std::lock_guard<std::mutex> lock(network);
+      announcement_t &announcement = announcements[peer];
+
+      if(announcement.received && YoYoFirmwareUpdate::isSource(announcement.host, announcement.sender, gateway)) {
+        firmwareUpdate.schedule(announcement.host, announcement.port, announcement.md5);
+      }
+      announcement.received = false;
+    }
+
+    //as loop() does - the real update() restarts the device once it has flashed the image:
+    if(firmwareUpdate.isDue()) {
+      if(firmwareUpdate.update() == HTTP_UPDATE_OK) {
+        flashed++;
+        done = true;
+      }
+      else check(firmwareUpdate.isPending(), "a busy server is retried");
+    }
+
+    std::this_thread::yield();
+  }
+}
+
+int main() {
+  std::vector<uint8_t> image(IMAGE_BYTES);
+  for(size_t n = 0; n < image.size(); ++n) image[n] = (uint8_t) (rand() >> 4);
+
+  File file = SPIFFS.open(YY_FIRMWARE_PATH, "w");
+  file.write(image.data(), image.size());
+  file.close();
+
+  httpUpdate.server = standInServer;
+
+  //only the gateway's own announcement - of an image it serves itself - is taken:
+  check(YoYoFirmwareUpdate::isSource("192.168.4.1", gateway, gateway), "the gateway is a source");
+  check(!YoYoFirmwareUpdate::isSource("192.168.4.1", IPAddress(192, 168, 4, 2), gateway), "another peer isn't a source");
+  check(!YoYoFirmwareUpdate::isSource("192.168.4.7", gateway, gateway), "the gateway passing on someone else's image isn't a source");
+  check(!YoYoFirmwareUpdate::isSource("not an address", gateway, gateway), "a host that isn't an address isn't a source");
+  check(!YoYoFirmwareUpdate::isSource("0.0.0.0", IPAddress(), IPAddress()), "without a gateway there's no source");
+
+  static YoYoIntentQueue::cell_t cells[4];
+  YoYoIntentQueue intents;
+  intents.setStorage(cells, 4);
+
+  std::vector<std::thread> peers;
+  for(int peer = 0; peer < PEERS; ++peer) peers.push_back(std::thread(runPeer, peer));
+
+  //a phone on the captive portal tries to have every peer flash its own image - the peers hear it from the phone, not the gateway:
+  {
+    std::lock_guard<std::mutex> lock(network);
+    for(int peer = 0; peer < PEERS; ++peer) {
+      announcement_t rogue = { true, IPAddress(192, 168, 4, 9), "192.168.4.9", 80, "0123456789abcdef0123456789abcdef" };
+      announcements[peer] = rogue;
+    }
+  }
+
+  //the manager's task - woken for each intent, as runTask() is:
+  std::thread managerTask([&]() {
+    bool distributed = false;
+
+    while(!distributed) {
+      yy_intent_t *intent = intents.front();
+
+      if(intent) {
+        if(intent -> type == YY_INTENT_DISTRIBUTE_FIRMWARE) {
+          std::lock_guard<std::mutex> task(serverTask);
+          check(server.share(YY_FIRMWARE_PATH), "the image is shared");
+
+          std::lock_guard<std::mutex> lock(network);
+          for(int peer = 0; peer < PEERS; ++peer) {
+            announcement_t announcement = { true, gateway, "192.168.4.1", 80, "" };
+            strcpy(announcement.md5, server.getMD5());
+            announcements[peer] = announcement;
+          }
+          distributed = true;
+        }
+        intents.pop();
+      }
+      else std::this_thread::yield();
+    }
+  });
+
+  //the sketch - distributeFirmware() from another task only queues it:
+  uint32_t position;
+  yy_intent_t *intent = intents.reserve(&position);
+  check(intent != NULL, "the intent is queued");
+  if(intent) {
+    intent -> type = YY_INTENT_DISTRIBUTE_FIRMWARE;
+    intent -> length = 0;
+    intents.commit(position);
+  }
+  managerTask.join();
+
+  //time passes much faster than it does here - the peers' retries back off by seconds:
+  while(flashed < PEERS && millis() < GIVE_UP_MS) {
+    hostMillis() += 100;
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  running = false;
+  for(std::thread &peer : peers) peer.join();
+
+  MD5Builder expected;
+  expected.begin();
+  expected.add(image.data(), image.size());
+  expected.calculate();
+
+  check(expected.toString().equalsIgnoreCase(server.getMD5()), "the shared image's MD5");
+  check(flashed == PEERS, "every peer flashed the image");
+  check(mostTransfers > 0 && mostTransfers <= YY_FIRMWARE_MAX_TRANSFERS, "no more than YY_FIRMWARE_MAX_TRANSFERS at once");
+  check(transfers == 0, "every transfer ended");
+
+  printf("%i of %i peers flashed in %u simulated s - at most %i at once, %i turned away to retry\n", flashed.load(), PEERS,
+          (unsigned int) (millis() / 1000), mostTransfers, turnedAway.load());
+
+  return(failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,184 @@
+#ifndef Arduino_h
+#define Arduino_h
+
+//Just enough of the Arduino core (and of ESPAsyncWebServer and ArduinoJson) for the helpers in src/YoYoWiFiManager to build on a PC
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <strings.h>
+#include <atomic>
+#include <string>
+
+//a clock the tests move on themselves:
+inline std::atomic<uint32_t> &hostMillis() {
+  static std::atomic<uint32_t> ms(0);
+  return(ms);
+}
+
+inline uint32_t millis() {
+  return(hostMillis().load());
+}
+
+inline uint32_t micros() {
+  return(hostMillis().load() * 1000);
+}
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+      size_t n = 0;
+      while(n < size && write(buffer[n])) n++;
+      return(n);
+    }
+
+    size_t print(const char *s) {
+      return(write((const uint8_t *) s, strlen(s)));
+    }
+
+    size_t printf(const char *format, ...) {
+      char buffer[256];
+      va_list args;
+      va_start(args, format);
+      int length = vsnprintf(buffer, sizeof(buffer), format, args);
+      va_end(args);
+
+      return(length > 0 ? write((const uint8_t *) buffer, length < (int) sizeof(buffer) ? length : sizeof(buffer) - 1) : 0);
+    }
+};
+
+class Stream : public Print {
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+
+    virtual size_t readBytes(uint8_t *buffer, size_t length) {
+      size_t n = 0;
+      int c;
+      while(n < length && (c = read()) >= 0) buffer[n++] = (uint8_t) c;
+      return(n);
+    }
+};
+
+class String {
+  private:
+    std::string text;
+
+  public:
+    String(const char *text = "") : text(text ? text : "") {}
+
+    const char *c_str() const {
+      return(text.c_str());
+    }
+
+    size_t length() const {
+      return(text.length());
+    }
+
+    bool equals(const char *other) const {
+      return(text == (other ? other : ""));
+    }
+
+    bool equalsIgnoreCase(const char *other) const {
+      return(strcasecmp(text.c_str(), other ? other : "") == 0);
+    }
+
+    bool startsWith(const char *prefix) const {
+      return(text.compare(0, strlen(prefix), prefix) == 0);
+    }
+
+    String &operator+=(const char *more) {
+      text += more;
+      return(*this);
+    }
+};
+
+class HardwareSerial : public Print {
+  public:
+    size_t write(uint8_t c) {
+      return(fputc(c, stdout) == EOF ? 0 : 1);
+    }
+};
+
+inline HardwareSerial &hostSerial() {
+  static HardwareSerial serial;
+  return(serial);
+}
+#define Serial hostSerial()
+
+inline long random(long max) {
+  return(max > 0 ? rand() % max : 0);
+}
+
+class EspClass {
+  public:
+    String getSketchMD5() {
+      return(String("00000000000000000000000000000000"));
+    }
+};
+
+inline EspClass &hostESP() {
+  static EspClass esp;
+  return(esp);
+}
+#define ESP hostESP()
+
+class IPAddress {
+  private:
+    uint32_t address = 0;
+
+  public:
+    IPAddress() {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : address(a | (b << 8) | (c << 16) | ((uint32_t) d << 24)) {}
+
+    bool operator==(const IPAddress &other) const {
+      return(address == other.address);
+    }
+
+    operator uint32_t() const {
+      return(address);
+    }
+
+    bool fromString(const char *text) {
+      unsigned int a, b, c, d;
+      char extra;
+
+      bool success = text && sscanf(text, "%u.%u.%u.%u%c", &a, &b, &c, &d, &extra) == 4 && a < 256 && b < 256 && c < 256 && d < 256;
+      if(success) *this = IPAddress(a, b, c, d);
+
+      return(success);
+    }
+};
+
+//FreeRTOS - a critical section is a mutex here, so that ThreadSanitizer can see it:
+#if defined(ESP32)
+  #include <mutex>
+
+  struct portMUX_TYPE {
+    std::mutex mutex;
+  };
+  #define portMUX_INITIALIZER_UNLOCKED {}
+  #define portENTER_CRITICAL(mux) (mux) -> mutex.lock()
+  #define portEXIT_CRITICAL(mux) (mux) -> mutex.unlock()
+#endif
+
+//ESP-IDF:
+#ifndef ESP_WIFI_MAX_CONN_NUM
+  #define ESP_WIFI_MAX_CONN_NUM 10
+#endif
+
+//ESPAsyncWebServer:
+typedef uint8_t WebRequestMethodComposite;
+enum { HTTP_GET = 0b00000001, HTTP_POST = 0b00000010, HTTP_DELETE = 0b00000100 };
+
+//ArduinoJson:
+class JsonVariant {};
+template<typename TAllocator> class BasicJsonDocument;
+
+#endif
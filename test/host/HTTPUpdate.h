@@ -0,0 +1,34 @@
+#ifndef HTTPUpdate_h
+#define HTTPUpdate_h
+
+//The ESP32 core's HTTPUpdate - rather than fetching the image and flashing it, it hands the request to whatever stands in for
+//the server, which answers as the updater would: HTTP_UPDATE_OK once an image has been streamed and checked against its x-MD5
+
+#include <Arduino.h>
+
+class WiFiClient {};
+
+typedef enum {
+  HTTP_UPDATE_FAILED,
+  HTTP_UPDATE_NO_UPDATES,
+  HTTP_UPDATE_OK
+} t_httpUpdate_return;
+
+class HTTPUpdate {
+  public:
+    t_httpUpdate_return (*server)(const char *host, uint16_t port, const char *uri) = NULL;
+
+    void rebootOnUpdate(bool) {}
+
+    t_httpUpdate_return update(WiFiClient &, const char *host, uint16_t port, const char *uri) {
+      return(server ? server(host, port, uri) : HTTP_UPDATE_FAILED);
+    }
+};
+
+inline HTTPUpdate &hostHTTPUpdate() {
+  static HTTPUpdate update;
+  return(update);
+}
+#define httpUpdate hostHTTPUpdate()
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef SPIFFS_h
+#define SPIFFS_h
+
+//A file system held in memory - just enough of SPIFFS for the helpers, counting the writes that would reach the flash
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class File : public Stream {
+  private:
+    std::shared_ptr<std::vector<uint8_t> > data;
+    size_t position = 0;
+    bool writing = false;
+
+  public:
+    File() {}
+    File(std::shared_ptr<std::vector<uint8_t> > data, bool writing) : data(data), writing(writing) {}
+
+    operator bool() const {
+      return(data != NULL);
+    }
+
+    size_t write(uint8_t c) {
+      return(write(&c, 1));
+    }
+
+    size_t write(const uint8_t *buffer, size_t size);
+
+    int available() {
+      return(data && !writing ? (int) (data -> size() - position) : 0);
+    }
+
+    int read() {
+      return(available() > 0 ? (*data)[position++] : -1);
+    }
+
+    size_t size() {
+      return(data ? data -> size() : 0);
+    }
+
+    void close() {
+      data.reset();
+      position = 0;
+    }
+};
+
+class SPIFFSFS {
+  private:
+    std::map<std::string, std::shared_ptr<std::vector<uint8_t> > > files;
+    std::mutex mutex;
+    std::atomic<uint32_t> writes;
+
+  public:
+    SPIFFSFS() : writes(0) {}
+
+    File open(const char *path, const char *mode) {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      if(mode[0] == 'w') {
+        files[path] = std::make_shared<std::vector<uint8_t> >();
+        return(File(files[path], true));
+      }
+
+      auto file = files.find(path);
+      return(file != files.end() ? File(file -> second, false) : File());
+    }
+
+    bool exists(const char *path) {
+      std::lock_guard<std::mutex> lock(mutex);
+      return(files.count(path) > 0);
+    }
+
+    bool remove(const char *path) {
+      std::lock_guard<std::mutex> lock(mutex);
+      return(files.erase(path) > 0);
+    }
+
+    bool rename(const char *from, const char *to) {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto file = files.find(from);
+
+      if(file == files.end() || files.count(to) > 0) return(false);
+      files[to] = file -> second;
+      files.erase(file);
+
+      return(true);
+    }
+
+    void format() {
+      std::lock_guard<std::mutex> lock(mutex);
+      files.clear();
+    }
+
+    //each call to File::write - the flash is written a page at a time however little is given to it:
+    std::atomic<uint32_t> &getWrites() {
+      return(writes);
+    }
+};
+
+inline SPIFFSFS &hostSPIFFS() {
+  static SPIFFSFS fs;
+  return(fs);
+}
+#define SPIFFS hostSPIFFS()
+
+inline size_t File::write(const uint8_t *buffer, size_t size) {
+  if(!data || !writing) return(0);
+
+  data -> insert(data -> end(), buffer, buffer + size);
+  SPIFFS.getWrites()++;
+
+  return(size);
+}
+
+#endif
@@ -0,0 +1,336 @@
+//Task mode on the ESP32, with a std::thread for each task. Built with -fsanitize=thread - so a missing fence or lock is reported
+//as a race as well as checked for here:
+// - the intent queue alone: several producer threads (request handlers, the sketch) push intents while one consumer (loop()) applies them
+// - the tasks around it: the manager's task runs loop() as runTask() does - woken by each intent, or once its interval is up - and
+//   syncs an asset through the upload slot, while the web server's task handles POSTs, uploads to the same slot and /yoyo/logs,
+//   and the sketch connects and reads the status snapshot
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <MD5Builder.h>
+#include <HTTPUpdate.h>
+#include <condition_variable>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "YoYoLog.h"
+#include "YoYoBroadcastQueue.h"
+#include "YoYoIntentQueue.h"
+#include "YoYoFileUpload.h"
+
+#define PRODUCERS 4
+#define INTENTS_PER_PRODUCER 50000
+#define QUEUE_DEPTH 4                     //the default - so the queue is full much of the time
+
+#define TASK_INTERVAL_MS 2                //startTask()'s intervalMs - short, so the task also wakes without being notified
+#define REQUESTS 2000                     //handled by the web server's task
+#define SKETCH_CONNECTS 2000
+#define UPLOAD_BYTES 4096
+#define UPLOAD_BUFFER_BYTES 1024
+
+static std::atomic<int> failures(0);
+
+static void fail(const char *what, uint32_t seq, uint32_t producer) {
+  fprintf(stderr, "FAIL: %s - %u from %u\n", what, (unsigned int) seq, (unsigned int) producer);
+  failures++;
+}
+
+typedef struct {
+  uint32_t producer;
+  uint32_t seq;
+} stamp_t;
+
+//Fills the cell at the back of the queue with a stamped intent - returns false if the queue is full:
+static bool push(YoYoIntentQueue &intents, yy_intent_type_t type, uint32_t producer, uint32_t seq) {
+  uint32_t position;
+  yy_intent_t *intent = intents.reserve(&position);
+
+  if(intent) {
+    stamp_t stamp = { producer, seq };
+    intent -> type = type;
+    intent -> route = producer;
+    intent -> length = sizeof(stamp) + (seq % 64);
+    memcpy(intent -> body, &stamp, sizeof(stamp));
+    memset(&intent -> body[sizeof(stamp)], (uint8_t) seq, seq % 64);
+    intents.commit(position);
+  }
+
+  return(intent != NULL);
+}
+
+//Checks each producer's intents arrive whole and in the order they were pushed:
+static void receive(yy_intent_t *intent, uint32_t *next, uint32_t producers) {
+  stamp_t stamp;
+  memcpy(&stamp, intent -> body, sizeof(stamp));
+
+  if(stamp.producer >= producers || intent -> route != (int) stamp.producer || stamp.seq != next[stamp.producer] || intent -> length != sizeof(stamp) + (stamp.seq % 64)) {
+    fail("intent out of order or torn", stamp.seq, stamp.producer);
+  }
+  for(size_t n = sizeof(stamp); n < intent -> length; ++n) {
+    if((uint8_t) intent -> body[n] != (uint8_t) stamp.seq) {
+      fail("intent has a torn body", stamp.seq, stamp.producer);
+      break;
+    }
+  }
+
+  next[stamp.producer % producers]++;
+}
+
+//The intent queue alone
+//======================
+
+static YoYoIntentQueue::cell_t cells[QUEUE_DEPTH];
+static YoYoIntentQueue intents;
+
+static void produce(uint32_t producer) {
+  for(uint32_t seq = 0; seq < INTENTS_PER_PRODUCER; ) {
+    if(push(intents, YY_INTENT_RECEIVED, producer, seq)) seq++;
+    else std::this_thread::yield();   //full - as a handler would answer 503
+  }
+}
+
+static void stressQueue() {
+  intents.setStorage(cells, QUEUE_DEPTH);
+
+  std::vector<std::thread> producers;
+  for(uint32_t n = 0; n < PRODUCERS; ++n) producers.push_back(std::thread(produce, n));
+
+  uint32_t next[PRODUCERS] = {0};
+  uint32_t received = 0;
+
+  while(received < PRODUCERS * INTENTS_PER_PRODUCER && failures == 0) {
+    yy_intent_t *intent = intents.front();
+
+    if(intent) {
+      receive(intent, next, PRODUCERS);
+      received++;
+      intents.pop();
+    }
+    else std::this_thread::yield();
+  }
+
+  for(std::thread &producer : producers) producer.join();
+
+  if(failures == 0 && intents.front() != NULL) fail("intents left over", 0, 0);
+
+  printf("%u intents from %i producers - %u turned away while full\n", (unsigned int) received, PRODUCERS, (unsigned int) intents.getDropped());
+}
+
+//The tasks
+//=========
+
+enum { WEB_SERVER, SKETCH, TASK_PRODUCERS };
+
+//ulTaskNotifyTake() and xTaskNotifyGive() - a count the manager's task waits on:
+class TaskNotification {
+  private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    uint32_t count = 0;
+
+  public:
+    void give() {
+      std::lock_guard<std::mutex> lock(mutex);
+      count++;
+      condition.notify_one();
+    }
+
+    void take(uint32_t timeoutMs) {
+      std::unique_lock<std::mutex> lock(mutex);
+      condition.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() { return(count > 0); });
+      count = 0;
+    }
+};
+
+//What YoYoWiFiManagerBase shares between its tasks:
+class Manager {
+  public:
+    YoYoIntentQueue::cell_t cells[QUEUE_DEPTH];
+    YoYoIntentQueue intents;
+    TaskNotification task;
+    std::atomic<bool> running;
+
+    uint8_t uploadBuffer[UPLOAD_BUFFER_BYTES];
+    YoYoFileUpload fileUpload;
+    std::atomic<int> uploadHolders;       //owners of the upload slot at once - never more than 1
+
+    //updateSnapshot() - peers and clients are always written equal, so a torn read shows:
+    portMUX_TYPE snapshotMux = portMUX_INITIALIZER_UNLOCKED;
+    struct {
+      uint32_t loops;
+      int peers;
+      int clients;
+    } snapshot = { 0, 0, 0 };
+
+    uint32_t loops = 0;                   //the manager's task's own
+    uint32_t next[TASK_PRODUCERS] = {0};
+    std::atomic<uint32_t> received;       //watched by the test
+    uint32_t synced = 0;
+
+    Manager() : running(true), uploadHolders(0), received(0) {
+      intents.setStorage(cells, QUEUE_DEPTH);
+      fileUpload.setStorage(uploadBuffer, sizeof(uploadBuffer));
+    }
+
+    //pushIntent() - from any task but the manager's:
+    bool pushIntent(yy_intent_type_t type, uint32_t producer, uint32_t seq) {
+      bool success = push(intents, type, producer, seq);
+      if(success) task.give();              //wakes loop() early
+
+      return(success);
+    }
+
+    //Claims the upload slot for owner and writes a file of fill to path through it - returns false if the slot was taken:
+    bool upload(void *owner, const char *path, uint8_t fill) {
+      if(!fileUpload.begin(owner, path)) return(false);
+      if(uploadHolders.fetch_add(1) != 0) fail("the upload slot claimed twice", fill, 0);
+
+      uint8_t data[UPLOAD_BYTES];
+      memset(data, fill, sizeof(data));
+
+      MD5Builder md5;
+      md5.begin();
+      md5.add(data, sizeof(data));
+      md5.calculate();
+
+      for(size_t n = 0; n < sizeof(data); n += 512) {
+        fileUpload.write(&data[n], 512);
+        std::this_thread::yield();
+      }
+      //written through the same temporary file - another owner writing at once would corrupt it:
+      if(!fileUpload.end(md5.toString().c_str()) || !fileUpload.isOwner(owner)) fail("an upload didn't land", fill, 0);
+
+      uploadHolders.fetch_sub(1);
+      fileUpload.release();
+
+      return(true);
+    }
+
+    //loop():
+    void loop() {
+      yy_intent_t *intent;
+      for(int n = 0; n < QUEUE_DEPTH && (intent = intents.front()) != NULL; ++n) {
+        receive(intent, next, TASK_PRODUCERS);
+        received++;
+        intents.pop();
+      }
+
+      //syncNextAsset() - sharing the slot with /yoyo/upload:
+      if(loops % 4 == 0 && upload(this, "/asset.bin", (uint8_t) loops)) synced++;
+
+      YY_LOGI("loop %u - %u intents", (unsigned int) loops, (unsigned int) received.load());
+      loops++;
+
+      //updateSnapshot():
+      portENTER_CRITICAL(&snapshotMux);
+      snapshot.loops = loops;
+      snapshot.peers = loops % 8;
+      snapshot.clients = loops % 8;
+      portEXIT_CRITICAL(&snapshotMux);
+    }
+
+    //runTask():
+    void runTask() {
+      while(running) {
+        loop();
+        task.take(TASK_INTERVAL_MS);
+      }
+    }
+
+    //countPeers() and the like from another task:
+    void readSnapshot() {
+      portENTER_CRITICAL(&snapshotMux);
+      int peers = snapshot.peers;
+      int clients = snapshot.clients;
+      portEXIT_CRITICAL(&snapshotMux);
+
+      if(peers != clients) fail("a torn snapshot", peers, clients);
+    }
+};
+
+//Counts the lines /yoyo/logs sends - and any that aren't whole:
+class LogResponse : public Print {
+  public:
+    std::string line;
+    uint32_t lines = 0;
+
+    size_t write(uint8_t c) {
+      line += (char) c;
+
+      if(c == '\n') {
+        unsigned int ms;
+        char level;
+        if(sscanf(line.c_str(), "%u %c ", &ms, &level) != 2 || strchr("EWID", level) == NULL) fail("a torn log line", lines, 0);
+        line.clear();
+        lines++;
+      }
+
+      return(1);
+    }
+};
+
+static void modelTasks() {
+  static char logBuffer[1024];
+  yyLog().setStorage(logBuffer, sizeof(logBuffer));
+
+  static Manager manager;
+  std::thread managerTask(&Manager::runTask, &manager);
+
+  //the web server's task - one, like AsyncTCP's:
+  uint32_t uploaded = 0;
+  uint32_t logLines = 0;
+  std::thread webServer([&]() {
+    int request;          //stands in for an AsyncWebServerRequest - only its address is used
+
+    for(uint32_t seq = 0; seq < REQUESTS; ) {
+      if(manager.pushIntent(YY_INTENT_RECEIVED, WEB_SERVER, seq)) seq++;
+
+      if(seq % 8 == 0 && manager.upload(&request, "/index.html", (uint8_t) seq)) uploaded++;
+
+      if(seq % 16 == 0) {
+        LogResponse response;
+        yyLog().print(response);
+        logLines += response.lines;
+        YY_LOGD("GET /yoyo/logs");
+      }
+
+      manager.readSnapshot();
+      std::this_thread::yield();
+    }
+  });
+
+  //the sketch - on Arduino's loop task:
+  std::thread sketch([&]() {
+    for(uint32_t seq = 0; seq < SKETCH_CONNECTS; ) {
+      if(manager.pushIntent(YY_INTENT_CONNECT, SKETCH, seq)) seq++;
+      manager.readSnapshot();
+      std::this_thread::yield();
+    }
+  });
+
+  webServer.join();
+  sketch.join();
+
+  //until everything pushed has been applied:
+  while(manager.received < REQUESTS + SKETCH_CONNECTS) {
+    if(failures > 0) break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  manager.running = false;
+  manager.task.give();
+  managerTask.join();
+
+  if(manager.synced == 0 || uploaded == 0) fail("both tasks had the upload slot", manager.synced, uploaded);
+  if(logLines == 0) fail("the log was read", 0, 0);
+
+  printf("%u loops applied %u intents - %u asset syncs and %u uploads through the one slot, %u log lines read\n", (unsigned int) manager.loops,
+          (unsigned int) manager.received.load(), (unsigned int) manager.synced, (unsigned int) uploaded, (unsigned int) logLines);
+}
+
+int main() {
+  stressQueue();
+  if(failures == 0) modelTasks();
+
+  return(failures == 0 ? 0 : 1);
+}
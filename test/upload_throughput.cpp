@@ -0,0 +1,104 @@
+//An upload as /yoyo/upload receives it - a portal asset arriving a TCP segment at a time - written through YoYoFileUpload to the
+//shim's file system. Reports the sustained throughput and how many writes reach the flash for each size of write-behind buffer,
+//and checks that what lands is whole, verified and in place - and that the reserved paths are refused.
+//Built for the ESP32, against the shim's SPIFFS and MD5Builder
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <MD5Builder.h>
+#include <HTTPUpdate.h>
+#include <chrono>
+#include <vector>
+
+#include "YoYoFileUpload.h"
+
+#define FILE_BYTES (1024 * 1024)
+#define SEGMENT_BYTES 1436            //what a TCP segment carries - and so each call to the body handler
+#define ROUNDS 8
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+  if(!condition) {
+    fprintf(stderr, "FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+//Streams file to path as the handler would - returns false if the upload wasn't accepted or didn't land:
+static bool upload(YoYoFileUpload &fileUpload, void *request, const char *path, const std::vector<uint8_t> &file, const char *md5) {
+  bool success = fileUpload.begin(request, path);
+
+  for(size_t index = 0; success && index < file.size(); index += SEGMENT_BYTES) {
+    size_t length = (file.size() - index < SEGMENT_BYTES) ? file.size() - index : SEGMENT_BYTES;
+    success = fileUpload.write(&file[index], length);
+  }
+  if(success) success = fileUpload.end(md5);
+  fileUpload.release();
+
+  return(success);
+}
+
+static bool isInPlace(const char *path, const std::vector<uint8_t> &file) {
+  File written = SPIFFS.open(path, "r");
+  bool result = written && written.size() == file.size();
+
+  for(size_t n = 0; result && n < file.size(); ++n) result = (written.read() == file[n]);
+  written.close();
+
+  return(result);
+}
+
+int main() {
+  std::vector<uint8_t> file(FILE_BYTES);
+  for(size_t n = 0; n < file.size(); ++n) file[n] = (uint8_t) (rand() >> 4);
+
+  MD5Builder builder;
+  builder.begin();
+  builder.add(file.data(), file.size());
+  builder.calculate();
+  char md5[33];
+  builder.getChars(md5);
+
+  int request;          //stands in for an AsyncWebServerRequest - only its address is used
+  const size_t bufferSizes[] = { 256, 512, 1024, 4096 };
+
+  printf("%-12s %10s %12s\n", "buffer bytes", "MB/s", "flash writes");
+
+  for(size_t bufferSize : bufferSizes) {
+    std::vector<uint8_t> buffer(bufferSize);
+    YoYoFileUpload fileUpload;
+    fileUpload.setStorage(buffer.data(), buffer.size());
+
+    bool landed = true;
+    uint32_t writes = SPIFFS.getWrites().load();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for(int round = 0; round < ROUNDS; ++round) landed = upload(fileUpload, &request, "/script.js", file, md5) && landed;
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    writes = (SPIFFS.getWrites().load() - writes) / ROUNDS;
+
+    check(landed && isInPlace("/script.js", file), "the upload landed whole");
+    check(writes == (FILE_BYTES + bufferSize - 1) / bufferSize, "the flash written a whole buffer at a time");
+    printf("%-12u %10.1f %12u\n", (unsigned int) bufferSize, (double) FILE_BYTES * ROUNDS / seconds / (1024 * 1024), (unsigned int) writes);
+  }
+
+  static uint8_t buffer[1024];
+  YoYoFileUpload fileUpload;
+  fileUpload.setStorage(buffer, sizeof(buffer));
+
+  //a checksum mismatch leaves the file that was there:
+  std::vector<uint8_t> other(file.begin(), file.begin() + 4096);
+  check(!upload(fileUpload, &request, "/script.js", other, md5), "a corrupt upload is refused");
+  check(fileUpload.isCorrupt() && isInPlace("/script.js", file), "the existing file is left as it was");
+  check(!SPIFFS.exists(YY_UPLOAD_TEMP_PATH), "the temporary file is removed");
+
+  //reserved paths:
+  check(!upload(fileUpload, &request, YY_UPLOAD_TEMP_PATH, other, NULL), "an upload to the temporary file is refused");
+  check(!upload(fileUpload, &request, YY_FIRMWARE_PATH, other, NULL) && !SPIFFS.exists(YY_FIRMWARE_PATH), "an upload to the firmware image is refused");
+  check(!upload(fileUpload, &request, "/../script.js", other, NULL), "an upload outside the root is refused");
+  check(!fileUpload.isActive(), "refused uploads aren't left claimed");
+
+  return(failures == 0 ? 0 : 1);
+}